@@ -0,0 +1,146 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file BenchHelper.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ */
+
+#include "BenchHelper.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <libethcore/BlockInfo.h>
+#include <libethereum/BlockChain.h>
+#include <libethereum/State.h>
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+// Count every heap allocation in the process, so suites can look at the difference across what they measure.
+static atomic<uint64_t> s_allocations(0);
+
+void* operator new(size_t _size)
+{
+	++s_allocations;
+	if (void* ret = malloc(_size ? _size : 1))
+		return ret;
+	throw bad_alloc();
+}
+
+void operator delete(void* _p) noexcept
+{
+	free(_p);
+}
+
+uint64_t eth::bench::allocations()
+{
+	return s_allocations;
+}
+
+Options::Options(int _argc, char** _argv)
+{
+	for (int i = 0; i < _argc; ++i)
+	{
+		string arg = _argv[i];
+		if (arg.size() > 2 && arg.substr(0, 2) == "--")
+			m_options[arg.substr(2)] = (i + 1 < _argc && string(_argv[i + 1]).substr(0, 2) != "--") ? _argv[++i] : "";
+	}
+}
+
+unsigned Options::get(string const& _name, unsigned _default) const
+{
+	auto it = m_options.find(_name);
+	return it == m_options.end() || it->second.empty() ? _default : stoul(it->second);
+}
+
+string Options::getString(string const& _name, string const& _default) const
+{
+	auto it = m_options.find(_name);
+	return it == m_options.end() ? _default : it->second;
+}
+
+js::mObject eth::bench::summarise(vector<double> _samples)
+{
+	js::mObject ret;
+	ret["count"] = (int)_samples.size();
+	if (_samples.empty())
+		return ret;
+
+	sort(_samples.begin(), _samples.end());
+	auto at = [&](double q) { return _samples[min<size_t>(_samples.size() - 1, size_t(q * _samples.size()))]; };
+	double total = 0;
+	for (auto s: _samples)
+		total += s;
+	ret["min"] = _samples.front();
+	ret["mean"] = total / _samples.size();
+	ret["p50"] = at(0.5);
+	ret["p90"] = at(0.9);
+	ret["p99"] = at(0.99);
+	ret["max"] = _samples.back();
+	return ret;
+}
+
+string eth::bench::freshPath(string const& _name)
+{
+	auto p = boost::filesystem::temp_directory_path() / ("ethbench-" + _name);
+	boost::filesystem::remove_all(p);
+	boost::filesystem::create_directories(p);
+	return p.string();
+}
+
+vector<bytes> eth::bench::mineChain(string const& _name, unsigned _blocks, unsigned _txs)
+{
+	KeyPair us = KeyPair::create();
+	vector<Address> them;
+	for (unsigned i = 0; i < _txs; ++i)
+		them.push_back(KeyPair::create().address());
+
+	string path = freshPath(_name);
+	BlockChain bc(path, true);
+	State s(us.address(), State::openDB(path, true));
+	u256 nonce = 0;
+
+	vector<bytes> ret;
+	for (unsigned i = 0; i < _blocks; ++i)
+	{
+		s.sync(bc);
+		// The first block's reward pays for the rest.
+		for (unsigned j = 0; i && j < _txs; ++j)
+		{
+			Transaction t;
+			t.nonce = nonce++;
+			t.value = 1;
+			t.gasPrice = 10 * szabo;
+			t.gas = c_txGas;
+			t.receiveAddress = them[j];
+			t.sign(us.secret());
+			s.execute(t.rlp());
+		}
+		s.commitToMine(bc);
+		MineInfo mi;
+		for (mi.completed = false; !mi.completed;)
+			mi = s.mine(100, true);
+		s.completeMine();
+		bc.import(s.blockData(), s.db());
+		ret.push_back(s.blockData());
+	}
+	return ret;
+}
@@ -0,0 +1,80 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file BenchHelper.h
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Bits and pieces shared between the benchmark suites.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#pragma warning(push)
+#pragma warning(disable: 4100)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "../json_spirit/json_spirit_reader_template.h"
+#include "../json_spirit/json_spirit_writer_template.h"
+#pragma GCC diagnostic pop
+#pragma warning(pop)
+#include <libethential/Common.h>
+
+namespace eth
+{
+namespace bench
+{
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Options given to a benchmark suite on the command line, as "--name value" pairs.
+ */
+class Options
+{
+public:
+	Options(int _argc, char** _argv);
+
+	bool has(std::string const& _name) const { return m_options.count(_name); }
+	unsigned get(std::string const& _name, unsigned _default) const;
+	std::string getString(std::string const& _name, std::string const& _default) const;
+
+private:
+	std::map<std::string, std::string> m_options;
+};
+
+/// Milliseconds elapsed between two points in time.
+inline double msBetween(Clock::time_point _from, Clock::time_point _to) { return std::chrono::duration<double, std::milli>(_to - _from).count(); }
+
+/// Summarise a set of samples as a JSON object of count, min, mean, p50, p90, p99 and max.
+json_spirit::mObject summarise(std::vector<double> _samples);
+
+/// @returns the number of heap allocations made by the process so far.
+uint64_t allocations();
+
+/// Create a fresh, empty directory for a benchmark's databases, removing anything already there.
+std::string freshPath(std::string const& _name);
+
+/// Mine a chain of @a _blocks blocks in fresh databases called @a _name, each but the first with @a _txs value
+/// transfers from the coinbase. @returns the blocks, in order.
+std::vector<bytes> mineChain(std::string const& _name, unsigned _blocks, unsigned _txs);
+
+}
+}
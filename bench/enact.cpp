@@ -0,0 +1,156 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file enact.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Block execution benchmark: a full block's transactions played back serially and in parallel.
+ *
+ * Mines a block funding a number of senders, then a block in which each of them sends a transfer. Most go to fresh
+ * addresses, but a given percentage go to another sender, whose own transfer then has to be executed again. We
+ * time State::enactOn() on the latter, serially and on several threads, and check the two agree. Heap allocations
+ * per transaction are reported for each.
+ */
+
+#include <random>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <libethential/Log.h>
+#include <libethcore/BlockInfo.h>
+#include <libethereum/BlockChain.h>
+#include <libethereum/State.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+int enactBench(Options const& _o, js::mObject& o_results)
+{
+	unsigned txCount = max(1u, _o.get("txs", 200));
+	unsigned threads = max(2u, _o.get("threads", max(2u, thread::hardware_concurrency())));
+	unsigned conflictPercent = min(100u, _o.get("conflicts", 5));
+	unsigned runs = max(1u, _o.get("runs", 5));
+	unsigned seed = _o.get("seed", 42);
+	c_genesisDifficulty = _o.get("difficulty", 64);
+
+	js::mObject config;
+	config["txs"] = (int)txCount;
+	config["threads"] = (int)threads;
+	config["conflictPercent"] = (int)conflictPercent;
+	config["runs"] = (int)runs;
+	o_results["config"] = config;
+
+	mt19937 rng(seed);
+	KeyPair us = KeyPair::create();
+	vector<KeyPair> senders;
+	for (unsigned i = 0; i < txCount; ++i)
+		senders.push_back(KeyPair::create());
+
+	string path = freshPath("enact");
+	BlockChain bc(path, true);
+	OverlayDB db = State::openDB(path, true);
+	State s(us.address(), db);
+	auto send = [&](KeyPair const& _from, Address _to, u256 _value)
+	{
+		Transaction t;
+		t.nonce = s.transactionsFrom(_from.address());
+		t.value = _value;
+		t.gasPrice = 10 * szabo;
+		t.gas = c_txGas;
+		t.receiveAddress = _to;
+		t.sign(_from.secret());
+		s.execute(t.rlp());
+	};
+	auto mine = [&]()
+	{
+		s.commitToMine(bc);
+		MineInfo mi;
+		for (mi.completed = false; !mi.completed;)
+			mi = s.mine(100, true);
+		s.completeMine();
+		bc.import(s.blockData(), s.db());
+		s.sync(bc);
+	};
+
+	// The first block's reward pays for the second's funding; the third is what we measure.
+	s.sync(bc);
+	mine();
+	u256 allowance = s.balance(us.address()) / (txCount + 1);
+	for (auto const& k: senders)
+		send(us, k.address(), allowance);
+	mine();
+	uniform_int_distribution<unsigned> percent(0, 99);
+	uniform_int_distribution<unsigned> other(0, txCount - 1);
+	unsigned conflicts = 0;
+	for (auto const& k: senders)
+		if (percent(rng) < conflictPercent)
+		{
+			send(k, senders[other(rng)].address(), 1);
+			++conflicts;
+		}
+		else
+			send(k, KeyPair::create().address(), 1);
+	s.commitToMine(bc);
+	MineInfo mi;
+	for (mi.completed = false; !mi.completed;)
+		mi = s.mine(100, true);
+	s.completeMine();
+	bytes block = s.blockData();
+	BlockInfo bi(block);
+
+	auto enactAll = [&](unsigned _threads, h256& o_root, uint64_t& o_allocations)
+	{
+		vector<double> ret;
+		o_allocations = 0;
+		for (unsigned i = 0; i < runs; ++i)
+		{
+			State e(us.address(), db);
+			uint64_t allocationsBefore = allocations();
+			auto start = Clock::now();
+			e.enactOn(&block, bi, bc, _threads);
+			ret.push_back(msBetween(start, Clock::now()));
+			o_allocations += allocations() - allocationsBefore;
+			o_root = e.rootHash();
+		}
+		o_allocations /= runs * max<size_t>(1, s.pending().size());
+		return ret;
+	};
+
+	h256 serialRoot;
+	h256 parallelRoot;
+	uint64_t serialAllocations;
+	uint64_t parallelAllocations;
+	vector<double> serial = enactAll(1, serialRoot, serialAllocations);
+	unsigned reexecutionsBefore = State::reexecutions();
+	vector<double> parallel = enactAll(threads, parallelRoot, parallelAllocations);
+	unsigned reexecutions = (State::reexecutions() - reexecutionsBefore) / runs;
+
+	js::mObject serialSummary = summarise(serial);
+	js::mObject parallelSummary = summarise(parallel);
+	o_results["included"] = (int)s.pending().size();
+	o_results["conflicts"] = (int)conflicts;
+	o_results["reexecutions"] = (int)reexecutions;
+	o_results["serialMs"] = serialSummary;
+	o_results["parallelMs"] = parallelSummary;
+	o_results["serialAllocationsPerTx"] = (boost::uint64_t)serialAllocations;
+	o_results["parallelAllocationsPerTx"] = (boost::uint64_t)parallelAllocations;
+	o_results["speedup"] = parallelSummary["p50"].get_real() ? serialSummary["p50"].get_real() / parallelSummary["p50"].get_real() : 0;
+	o_results["agree"] = serialRoot == parallelRoot;
+
+	boost::filesystem::remove_all(path);
+	return serialRoot == parallelRoot ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file log.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Logging benchmark: the cost of logging to block import.
+ *
+ * Mines a short chain, then imports it into fresh databases three times: with logging silent,
+ * with verbose logging posted synchronously and with verbose logging posted asynchronously.
+ * Messages go to a sink that only counts them, so what's measured is our overhead, not the terminal's.
+ */
+
+#include <atomic>
+#include <libethential/Log.h>
+#include <libethcore/BlockInfo.h>
+#include <libethereum/BlockChain.h>
+#include <libethereum/State.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+namespace
+{
+
+/// Import @a _blocks into fresh databases. @returns the milliseconds it took.
+double importChain(vector<bytes> const& _blocks, string const& _name)
+{
+	string path = freshPath("log-" + _name);
+	BlockChain bc(path, true);
+	OverlayDB db = State::openDB(path, true);
+	auto start = Clock::now();
+	for (auto const& b: _blocks)
+		bc.import(b, db);
+	return msBetween(start, Clock::now());
+}
+
+}
+
+int logBench(Options const& _o, js::mObject& o_results)
+{
+	unsigned blockCount = _o.get("blocks", 50);
+	unsigned txsPerBlock = _o.get("txs", 10);
+	int verbosity = _o.get("log-verbosity", 9);
+	c_genesisDifficulty = _o.get("difficulty", 64);
+
+	js::mObject config;
+	config["blocks"] = (int)blockCount;
+	config["txsPerBlock"] = (int)txsPerBlock;
+	config["logVerbosity"] = verbosity;
+	o_results["config"] = config;
+
+	int oldVerbosity = g_logVerbosity;
+	auto oldPost = g_logPost;
+	std::atomic<unsigned> messages(0);
+	g_logPost = [&](std::string const&, char const*) { ++messages; };
+
+	g_logVerbosity = -1;
+	vector<bytes> blocks = mineChain("log-source", blockCount, txsPerBlock);
+
+	g_logVerbosity = -1;
+	double silent = importChain(blocks, "silent");
+
+	g_logVerbosity = verbosity;
+	messages = 0;
+	double verbose = importChain(blocks, "sync");
+	unsigned verboseMessages = messages;
+
+	messages = 0;
+	startAsyncLogging();
+	double async = importChain(blocks, "async");
+	auto drainStart = Clock::now();
+	stopAsyncLogging();
+	double drain = msBetween(drainStart, Clock::now());
+	unsigned asyncMessages = messages;
+
+	g_logVerbosity = oldVerbosity;
+	g_logPost = oldPost;
+
+	js::mObject silentJS;
+	silentJS["ms"] = silent;
+	silentJS["msPerBlock"] = silent / blockCount;
+	o_results["silent"] = silentJS;
+
+	js::mObject verboseJS;
+	verboseJS["ms"] = verbose;
+	verboseJS["msPerBlock"] = verbose / blockCount;
+	verboseJS["messages"] = (int)verboseMessages;
+	o_results["verbose"] = verboseJS;
+
+	js::mObject asyncJS;
+	asyncJS["ms"] = async;
+	asyncJS["msPerBlock"] = async / blockCount;
+	asyncJS["drainMs"] = drain;
+	asyncJS["messages"] = (int)asyncMessages;
+	o_results["verboseAsync"] = asyncJS;
+
+	return 0;
+}
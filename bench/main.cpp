@@ -0,0 +1,77 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Benchmark driver. Runs a single named suite and writes its results to stdout as JSON.
+ */
+
+#include <iostream>
+#include <functional>
+#include <libethential/Log.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+int networkBench(Options const& _o, js::mObject& o_results);
+int logBench(Options const& _o, js::mObject& o_results);
+int sha3Bench(Options const& _o, js::mObject& o_results);
+int queryBench(Options const& _o, js::mObject& o_results);
+int txpoolBench(Options const& _o, js::mObject& o_results);
+int enactBench(Options const& _o, js::mObject& o_results);
+int vmBench(Options const& _o, js::mObject& o_results);
+int trieBench(Options const& _o, js::mObject& o_results);
+
+static const map<string, function<int(Options const&, js::mObject&)>> c_suites =
+{
+	{ "network", networkBench },
+	{ "log", logBench },
+	{ "sha3", sha3Bench },
+	{ "query", queryBench },
+	{ "txpool", txpoolBench },
+	{ "enact", enactBench },
+	{ "vm", vmBench },
+	{ "trie", trieBench },
+};
+
+void help()
+{
+	cerr << "Usage: bencheth <suite> [--verbosity <0..9>] [--<option> <value> ...]" << endl << "Suites:";
+	for (auto const& s: c_suites)
+		cerr << " " << s.first;
+	cerr << endl;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2 || !c_suites.count(argv[1]))
+	{
+		help();
+		return -1;
+	}
+
+	Options o(argc - 2, argv + 2);
+	g_logVerbosity = o.get("verbosity", 0);
+
+	js::mObject results;
+	results["suite"] = string(argv[1]);
+	int ret = c_suites.at(argv[1])(o, results);
+	cout << js::write_string(js::mValue(results), true) << endl;
+	return ret;
+}
@@ -0,0 +1,296 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file network.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Network benchmark: a handful of full nodes in one process, talking over loopback.
+ *
+ * Each node originates a share of a fixed number of value transfers at a fixed rate while the
+ * mining nodes keep producing blocks. We record when every transaction and block first becomes
+ * visible at every node and report propagation latencies and the traffic each node generated.
+ */
+
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <libethential/Log.h>
+#include <libethcore/BlockInfo.h>
+#include <libethereum/Client.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+namespace
+{
+
+static const u256 c_benchGasPrice = 10 * szabo;
+
+struct Node
+{
+	KeyPair key;
+	std::string path;
+	std::shared_ptr<Client> client;
+	u256 nonce;								///< Nonce of the next transaction this node originates.
+	eth::uint floor = 0;							///< Blocks at or below this number were there before we started measuring.
+	std::map<h256, Clock::time_point> seenTxs;	///< When each of our transactions was first visible here, pending or mined.
+	std::map<h256, Clock::time_point> minedTxs;	///< When each of our transactions was first visible here in a block.
+	std::map<h256, Clock::time_point> seenBlocks;	///< When each new block first became our best.
+	NetworkTraffic traffic;					///< Traffic totals at the point we started measuring.
+};
+
+/// Note anything new that @a _n can see as of @a _now.
+void poll(Node& _n, std::set<h256> const& _ours, Clock::time_point _now)
+{
+	for (auto const& t: _n.client->pending())
+	{
+		auto h = t.sha3();
+		if (_ours.count(h))
+			_n.seenTxs.insert(make_pair(h, _now));
+	}
+
+	BlockChain const& bc = _n.client->blockChain();
+	for (h256 h = bc.currentHash(); !_n.seenBlocks.count(h); )
+	{
+		auto d = bc.details(h);
+		if (d.number <= _n.floor)
+			break;
+		_n.seenBlocks.insert(make_pair(h, _now));
+		for (auto const& tr: RLP(bc.block(h))[1])
+		{
+			auto th = sha3(tr[0].data());
+			if (_ours.count(th))
+			{
+				_n.seenTxs.insert(make_pair(th, _now));
+				_n.minedTxs.insert(make_pair(th, _now));
+			}
+		}
+		h = d.parent;
+	}
+}
+
+/// Wait until @a _f returns true, or until @a _deadline. @returns true iff @a _f returned true.
+template <class F> bool waitFor(F const& _f, Clock::time_point _deadline)
+{
+	while (!_f())
+	{
+		if (Clock::now() > _deadline)
+			return false;
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	return true;
+}
+
+js::mValue toJS(NetworkTraffic const& _t)
+{
+	js::mObject ret;
+	ret["bytesIn"] = _t.bytesIn;
+	ret["bytesOut"] = _t.bytesOut;
+	ret["packetsIn"] = _t.packetsIn;
+	ret["packetsOut"] = _t.packetsOut;
+	ret["payloadBytesIn"] = _t.payloadBytesIn;
+	ret["payloadBytesOut"] = _t.payloadBytesOut;
+	return ret;
+}
+
+}
+
+int networkBench(Options const& _o, js::mObject& o_results)
+{
+	unsigned nodeCount = max(2u, _o.get("nodes", 4));
+	unsigned txCount = _o.get("txs", 200);
+	unsigned minerCount = min(nodeCount, _o.get("miners", 1));
+	unsigned rate = max(1u, _o.get("rate", 50));
+	unsigned short port = (unsigned short)_o.get("port", 30400);
+	unsigned timeout = _o.get("timeout", 300);
+
+	// Must be before anything asks for the genesis block.
+	c_genesisDifficulty = _o.get("difficulty", 256);
+
+	js::mObject config;
+	config["nodes"] = (int)nodeCount;
+	config["txs"] = (int)txCount;
+	config["miners"] = (int)minerCount;
+	config["rate"] = (int)rate;
+	config["difficulty"] = (int)c_genesisDifficulty;
+	o_results["config"] = config;
+
+	vector<Node> nodes(nodeCount);
+	for (unsigned i = 0; i < nodeCount; ++i)
+	{
+		nodes[i].key = KeyPair::create();
+		nodes[i].path = freshPath("network-" + toString(i));
+		nodes[i].client = make_shared<Client>("bench" + toString(i), nodes[i].key.address(), nodes[i].path, true);
+	}
+
+	// A line, with everyone also connected to the first node so the diameter stays small.
+	for (unsigned i = 0; i < nodeCount; ++i)
+	{
+		nodes[i].client->startNetwork(port + i, i ? "127.0.0.1" : "", port + i - 1, NodeMode::Full, nodeCount, "", false);
+		if (i > 1)
+			nodes[i].client->connect("127.0.0.1", port);
+	}
+
+	auto deadline = Clock::now() + chrono::seconds(timeout);
+	if (!waitFor([&]() { for (auto const& n: nodes) if (!n.client->peerCount()) return false; return true; }, deadline))
+	{
+		cwarn << "Nodes failed to connect to each other.";
+		return -1;
+	}
+
+	// Fund everyone from the first node's coinbase so each node can originate its share of the transactions.
+	u256 perTx = c_txGas * c_benchGasPrice + 1;
+	u256 perNode = perTx * (txCount / nodeCount + 1);
+	Client& funder = *nodes[0].client;
+	funder.setTurboMining();
+	funder.setForceMining(true);
+	funder.startMining();
+	if (!waitFor([&]() { return funder.balanceAt(nodes[0].key.address(), -1) >= perNode * nodeCount + perTx * nodeCount; }, deadline))
+	{
+		cwarn << "Couldn't mine enough to fund the nodes.";
+		return -1;
+	}
+
+	u256 nonce = funder.countAt(nodes[0].key.address(), 0);
+	for (unsigned i = 1; i < nodeCount; ++i)
+	{
+		Transaction t;
+		t.nonce = nonce++;
+		t.value = perNode;
+		t.gasPrice = c_benchGasPrice;
+		t.gas = c_txGas;
+		t.receiveAddress = nodes[i].key.address();
+		t.sign(nodes[0].key.secret());
+		bytes rlp = t.rlp();
+		funder.inject(&rlp);
+	}
+	auto funded = [&]()
+	{
+		for (auto const& n: nodes)
+			for (auto const& m: nodes)
+				if (n.client->balanceAt(m.key.address(), -1) < perNode)
+					return false;
+		return true;
+	};
+	if (!waitFor(funded, deadline))
+	{
+		cwarn << "Funding transactions didn't make it to every node.";
+		return -1;
+	}
+	funder.stopMining();
+	funder.setForceMining(false);
+
+	for (auto& n: nodes)
+	{
+		n.nonce = n.client->countAt(n.key.address(), 0);
+		n.floor = n.client->blockChain().number();
+		n.traffic = n.client->networkTraffic();
+	}
+	for (unsigned i = 0; i < minerCount; ++i)
+	{
+		nodes[i].client->setTurboMining();
+		nodes[i].client->setForceMining(true);
+		nodes[i].client->startMining();
+	}
+
+	// Originate transactions round-robin at the given rate, noting what everyone sees as we go.
+	set<h256> ours;
+	map<h256, pair<Clock::time_point, unsigned>> injected;
+	auto start = Clock::now();
+	deadline = start + chrono::seconds(timeout);
+	auto allMined = [&]() { for (auto const& n: nodes) if (n.minedTxs.size() < txCount) return false; return true; };
+	bool complete = false;
+	for (unsigned sent = 0; !(complete = sent == txCount && allMined()) && Clock::now() < deadline;)
+	{
+		auto now = Clock::now();
+		for (; sent < txCount && msBetween(start, now) * rate >= sent * 1000.0; ++sent)
+		{
+			unsigned from = sent % nodeCount;
+			Transaction t;
+			t.nonce = nodes[from].nonce++;
+			t.value = 1;
+			t.gasPrice = c_benchGasPrice;
+			t.gas = c_txGas;
+			t.receiveAddress = nodes[(from + 1) % nodeCount].key.address();
+			t.sign(nodes[from].key.secret());
+			bytes rlp = t.rlp();
+			auto h = sha3(rlp);
+			ours.insert(h);
+			injected[h] = make_pair(Clock::now(), from);
+			nodes[from].client->inject(&rlp);
+		}
+		for (auto& n: nodes)
+			poll(n, ours, Clock::now());
+		this_thread::sleep_for(chrono::milliseconds(5));
+	}
+	auto duration = msBetween(start, Clock::now());
+
+	vector<double> txPropagation;
+	vector<double> txInclusion;
+	for (auto const& i: injected)
+		for (unsigned n = 0; n < nodeCount; ++n)
+		{
+			if (n != i.second.second && nodes[n].seenTxs.count(i.first))
+				txPropagation.push_back(msBetween(i.second.first, nodes[n].seenTxs[i.first]));
+			if (nodes[n].minedTxs.count(i.first))
+				txInclusion.push_back(msBetween(i.second.first, nodes[n].minedTxs[i.first]));
+		}
+
+	// A block's origin is wherever it was seen first; that's the miner, give or take a polling interval.
+	map<h256, Clock::time_point> firstSeen;
+	for (auto const& n: nodes)
+		for (auto const& b: n.seenBlocks)
+			if (!firstSeen.count(b.first) || b.second < firstSeen[b.first])
+				firstSeen[b.first] = b.second;
+	vector<double> blockPropagation;
+	for (auto const& n: nodes)
+		for (auto const& b: n.seenBlocks)
+			if (b.second != firstSeen[b.first])
+				blockPropagation.push_back(msBetween(firstSeen[b.first], b.second));
+
+	js::mArray nodeResults;
+	for (auto& n: nodes)
+	{
+		NetworkTraffic t = n.client->networkTraffic();
+		t.bytesIn -= n.traffic.bytesIn;
+		t.bytesOut -= n.traffic.bytesOut;
+		t.packetsIn -= n.traffic.packetsIn;
+		t.packetsOut -= n.traffic.packetsOut;
+		t.payloadBytesIn -= n.traffic.payloadBytesIn;
+		t.payloadBytesOut -= n.traffic.payloadBytesOut;
+		js::mObject o = toJS(t).get_obj();
+		o["peers"] = (int)n.client->peerCount();
+		o["height"] = (int)n.client->blockChain().number();
+		nodeResults.push_back(o);
+	}
+
+	o_results["complete"] = complete;
+	o_results["durationMs"] = duration;
+	o_results["blocks"] = (int)firstSeen.size();
+	o_results["throughputTxPerSec"] = txCount * 1000.0 / duration;
+	o_results["txPropagationMs"] = summarise(txPropagation);
+	o_results["txInclusionMs"] = summarise(txInclusion);
+	o_results["blockPropagationMs"] = summarise(blockPropagation);
+	o_results["nodes"] = nodeResults;
+
+	for (auto& n: nodes)
+	{
+		n.client.reset();
+		boost::filesystem::remove_all(n.path);
+	}
+	return complete ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file query.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Query benchmark: how long state queries take while the client is busy importing.
+ *
+ * Mines a chain, then has several threads hammer a fresh client with balanceAt() calls, first while
+ * it's idle and then while it imports the whole chain. What we want to see is that the second set of
+ * latencies looks like the first.
+ */
+
+#include <atomic>
+#include <thread>
+#include <boost/filesystem.hpp>
+#include <libethential/Log.h>
+#include <libethcore/BlockInfo.h>
+#include <libethereum/Client.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+namespace
+{
+
+/// Call balanceAt(@a _a) on @a _c from @a _threads threads until @a _stop is set. @returns each call's latency in ms.
+vector<double> hammer(Client& _c, Address _a, unsigned _threads, atomic<bool>& _stop)
+{
+	vector<vector<double>> latencies(_threads);
+	vector<thread> readers;
+	for (unsigned i = 0; i < _threads; ++i)
+		readers.push_back(thread([&, i]()
+		{
+			while (!_stop)
+			{
+				auto start = Clock::now();
+				_c.balanceAt(_a, 0);
+				latencies[i].push_back(msBetween(start, Clock::now()));
+			}
+		}));
+	for (auto& r: readers)
+		r.join();
+
+	vector<double> ret;
+	for (auto const& l: latencies)
+		ret.insert(ret.end(), l.begin(), l.end());
+	return ret;
+}
+
+}
+
+int queryBench(Options const& _o, js::mObject& o_results)
+{
+	unsigned blockCount = _o.get("blocks", 100);
+	unsigned txsPerBlock = _o.get("txs", 20);
+	unsigned readerCount = max(1u, _o.get("readers", 4));
+	unsigned idleMs = _o.get("idle-ms", 1000);
+	unsigned timeout = _o.get("timeout", 300);
+	c_genesisDifficulty = _o.get("difficulty", 64);
+
+	js::mObject config;
+	config["blocks"] = (int)blockCount;
+	config["txsPerBlock"] = (int)txsPerBlock;
+	config["readers"] = (int)readerCount;
+	o_results["config"] = config;
+
+	vector<bytes> blocks = mineChain("query-source", blockCount, txsPerBlock);
+	Address probe = BlockInfo(blocks.front()).coinbaseAddress;
+
+	string path = freshPath("query");
+	unique_ptr<Client> c(new Client("bench", KeyPair::create().address(), path, true));
+
+	atomic<bool> stop(false);
+	thread idleTimer([&]() { this_thread::sleep_for(chrono::milliseconds(idleMs)); stop = true; });
+	vector<double> idle = hammer(*c, probe, readerCount, stop);
+	idleTimer.join();
+
+	stop = false;
+	double importMs = 0;
+	bool complete = false;
+	thread importer([&]()
+	{
+		auto start = Clock::now();
+		auto deadline = start + chrono::seconds(timeout);
+		for (auto const& b: blocks)
+			c->injectBlock(&b);
+		while (!(complete = c->blockChain().number() >= blockCount) && Clock::now() < deadline)
+			this_thread::sleep_for(chrono::milliseconds(1));
+		importMs = msBetween(start, Clock::now());
+		stop = true;
+	});
+	vector<double> busy = hammer(*c, probe, readerCount, stop);
+	importer.join();
+
+	o_results["complete"] = complete;
+	o_results["importMs"] = importMs;
+	o_results["idleLatencyMs"] = summarise(idle);
+	o_results["importLatencyMs"] = summarise(busy);
+	o_results["idleQueriesPerSec"] = idle.size() * 1000.0 / idleMs;
+	o_results["importQueriesPerSec"] = importMs ? busy.size() * 1000.0 / importMs : 0;
+
+	c.reset();
+	boost::filesystem::remove_all(path);
+	return complete ? 0 : 1;
+}
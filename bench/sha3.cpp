@@ -0,0 +1,119 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file sha3.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Hashing benchmark: our Keccak against CryptoPP's, one at a time and in batches, and the
+ * transaction manifest root built through a trie database against orderedTrieRoot().
+ */
+
+#include <libethcore/CryptoHeaders.h>
+#include <libethcore/SHA3.h>
+#include <libethcore/TrieDB.h>
+#include <libethcore/MemoryDB.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+namespace
+{
+
+/// @returns nanoseconds per item for running @a _f over @a _count items, best of three.
+template <class F> double nsPer(unsigned _count, F const& _f)
+{
+	double best = 0;
+	for (unsigned run = 0; run < 3; ++run)
+	{
+		auto start = Clock::now();
+		_f();
+		double ns = msBetween(start, Clock::now()) * 1000000.0 / _count;
+		best = run ? min(best, ns) : ns;
+	}
+	return best;
+}
+
+}
+
+int sha3Bench(Options const& _o, js::mObject& o_results)
+{
+	unsigned count = max(1u, _o.get("count", 100000));
+	unsigned txs = max(1u, _o.get("txs", 200));
+
+	js::mObject config;
+	config["count"] = (int)count;
+	config["txs"] = (int)txs;
+	o_results["config"] = config;
+
+	bytes data(count + 1024);
+	for (unsigned i = 0; i < data.size(); ++i)
+		data[i] = (byte)(i * 181 + 7);
+	vector<h256> out(count);
+
+	js::mObject sizes;
+	bool agree = true;
+	for (unsigned size: { 32, 64, 136, 256, 512, 1024 })
+	{
+		vector<bytesConstRef> inputs;
+		for (unsigned i = 0; i < count; ++i)
+			inputs.push_back(bytesConstRef(data.data() + i, size));
+
+		js::mObject r;
+		r["cryptopp"] = nsPer(count, [&]()
+		{
+			for (unsigned i = 0; i < count; ++i)
+			{
+				CryptoPP::SHA3_256 ctx;
+				ctx.Update(inputs[i].data(), inputs[i].size());
+				ctx.Final(out[i].data());
+			}
+		});
+		h256 check = out[count - 1];
+		r["scalar"] = nsPer(count, [&]() { for (unsigned i = 0; i < count; ++i) sha3(inputs[i], out[i].ref()); });
+		agree = agree && out[count - 1] == check;
+		r["batch"] = nsPer(count, [&]() { sha3(inputs, out.data()); });
+		agree = agree && out[count - 1] == check;
+		sizes[toString(size)] = r;
+	}
+	o_results["nsPerHash"] = sizes;
+	o_results["agree"] = agree;
+
+	// The transaction manifest of a block of fake transactions of typical size.
+	vector<bytes> manifest;
+	for (unsigned i = 0; i < txs; ++i)
+		manifest.push_back(bytes(data.begin() + i, data.begin() + i + 180));
+	h256 viaDB;
+	js::mObject root;
+	root["trieDB"] = nsPer(txs, [&]()
+	{
+		MemoryDB tm;
+		GenericTrieDB<MemoryDB> t(&tm);
+		t.init();
+		for (unsigned i = 0; i < txs; ++i)
+		{
+			bytes k = rlp(i);
+			t.insert(&k, &manifest[i]);
+		}
+		viaDB = t.root();
+	});
+	root["orderedTrieRoot"] = nsPer(txs, [&]() { agree = agree && orderedTrieRoot(manifest) == viaDB; });
+	o_results["nsPerManifestEntry"] = root;
+	o_results["agree"] = agree;
+
+	return agree ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file trie.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Trie and state database benchmark.
+ *
+ * Fills a GenericTrieDB with a given number of keys, over a MemoryDB and over an OverlayDB on LevelDB, then times
+ * lookups in a shuffled order, a full iteration and the removal of half the keys. Keys are either random (sha3 of
+ * the seed and index, as account and storage keys are) or sequential big-endian integers, so every run with the same
+ * seed builds the same tries; the root is reported so that can be checked. For the OverlayDB we also time committing
+ * the nodes to disk. Lastly, State's commit is timed for a number of touched accounts each with a number of storage
+ * slots, separately from writing the result out to LevelDB.
+ */
+
+#include <random>
+#include <sstream>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <libethential/Log.h>
+#include <libethential/CommonIO.h>
+#include <libethcore/TrieDB.h>
+#include <libethcore/OverlayDB.h>
+#include <libethereum/State.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+namespace
+{
+
+/// Parse a comma-separated list of numbers.
+vector<unsigned> numbers(string const& _s)
+{
+	vector<unsigned> ret;
+	istringstream in(_s);
+	for (string n; getline(in, n, ',');)
+		if (!n.empty())
+			ret.push_back(stoul(n));
+	return ret;
+}
+
+js::mArray toJson(vector<unsigned> const& _v)
+{
+	js::mArray ret;
+	for (auto i: _v)
+		ret.push_back((int)i);
+	return ret;
+}
+
+/// Nanoseconds per item, for @a _count items done since @a _start.
+double nsEach(Clock::time_point _start, size_t _count)
+{
+	return _count ? msBetween(_start, Clock::now()) * 1000000 / _count : 0;
+}
+
+vector<h256> makeKeys(string const& _distribution, unsigned _count, unsigned _seed)
+{
+	vector<h256> ret;
+	ret.reserve(_count);
+	for (unsigned i = 0; i < _count; ++i)
+		ret.push_back(_distribution == "random" ? sha3(rlpList(_seed, i)) : h256(u256(i)));
+	return ret;
+}
+
+/// Time the trie operations over @a _db. @a _commit, if given, writes @a _db out and is timed too.
+template <class DB> js::mObject trieRun(DB& _db, vector<h256> const& _keys, unsigned _seed, function<void()> const& _commit)
+{
+	js::mObject ret;
+	GenericTrieDB<DB> t(&_db);
+	t.init();
+
+	vector<bytes> values;
+	values.reserve(_keys.size());
+	for (unsigned i = 0; i < _keys.size(); ++i)
+		values.push_back(rlp(i));
+
+	auto start = Clock::now();
+	for (unsigned i = 0; i < _keys.size(); ++i)
+		t.insert(_keys[i].ref(), &values[i]);
+	ret["insertNs"] = nsEach(start, _keys.size());
+	ret["root"] = toHex(t.root().ref());
+
+	if (_commit)
+	{
+		size_t nodes = _db.keys().size();
+		start = Clock::now();
+		_commit();
+		double ms = msBetween(start, Clock::now());
+		ret["nodes"] = (boost::uint64_t)nodes;
+		ret["commitMs"] = ms;
+		ret["commitNodesPerSec"] = ms ? nodes * 1000 / ms : 0;
+	}
+
+	vector<h256> order = _keys;
+	shuffle(order.begin(), order.end(), mt19937(_seed));
+	size_t found = 0;
+	start = Clock::now();
+	for (auto const& k: order)
+		found += !t.at(k.ref()).empty();
+	ret["lookupNs"] = nsEach(start, order.size());
+
+	size_t iterated = 0;
+	start = Clock::now();
+	for (auto i = t.begin(); i != t.end(); ++i)
+		++iterated;
+	ret["iterateNs"] = nsEach(start, iterated);
+
+	size_t removed = order.size() / 2;
+	start = Clock::now();
+	for (size_t i = 0; i < removed; ++i)
+		t.remove(order[i].ref());
+	ret["removeNs"] = nsEach(start, removed);
+
+	ret["found"] = (boost::uint64_t)found;
+	ret["iterated"] = (boost::uint64_t)iterated;
+	return ret;
+}
+
+}
+
+int trieBench(Options const& _o, js::mObject& o_results)
+{
+	vector<unsigned> sizes = numbers(_o.getString("sizes", "10000,100000"));
+	vector<unsigned> accounts = numbers(_o.getString("accounts", "100,1000,10000"));
+	vector<unsigned> slots = numbers(_o.getString("slots", "0,10,100"));
+	unsigned seed = _o.get("seed", 42);
+
+	js::mObject config;
+	config["sizes"] = toJson(sizes);
+	config["accounts"] = toJson(accounts);
+	config["slots"] = toJson(slots);
+	config["seed"] = (int)seed;
+	o_results["config"] = config;
+
+	int ret = 0;
+	js::mObject tries;
+	for (string distribution: { "random", "sequential" })
+	{
+		js::mObject d;
+		for (auto size: sizes)
+		{
+			vector<h256> keys = makeKeys(distribution, size, seed);
+			js::mObject o;
+
+			MemoryDB mem;
+			o["memory"] = trieRun(mem, keys, seed, nullptr);
+
+			string path = freshPath("trie");
+			{
+				OverlayDB db = State::openDB(path, true);
+				o["overlay"] = trieRun(db, keys, seed, [&]() { db.commit(); });
+			}
+			boost::filesystem::remove_all(path);
+
+			// The same keys must make the same trie, and every one of them must be found and iterated.
+			for (auto const& b: { "memory", "overlay" })
+			{
+				js::mObject const& r = o[b].get_obj();
+				if (r.at("root").get_str() != o["memory"].get_obj().at("root").get_str() || r.at("found").get_uint64() != size || r.at("iterated").get_uint64() != size)
+					ret = 1;
+			}
+			d[toString(size)] = o;
+		}
+		tries[distribution] = d;
+	}
+	o_results["trie"] = tries;
+
+	js::mObject state;
+	for (auto a: accounts)
+		for (auto s: slots)
+		{
+			map<Address, AddressState> cache;
+			for (unsigned i = 0; i < a; ++i)
+			{
+				AddressState as(1, u256(i) + 1, h256(), EmptySHA3);
+				for (unsigned j = 0; j < s; ++j)
+					as.setStorage(u256(sha3(rlpList(seed, i, j))), j + 1);
+				cache[right160(sha3(rlpList(seed, i)))] = as;
+			}
+
+			string path = freshPath("trie");
+			js::mObject o;
+			{
+				OverlayDB db = State::openDB(path, true);
+				TrieDB<Address, OverlayDB> trie(&db);
+				trie.init();
+				auto start = Clock::now();
+				eth::commit(cache, db, trie);
+				o["commitMs"] = msBetween(start, Clock::now());
+				o["nodes"] = (boost::uint64_t)db.keys().size();
+				start = Clock::now();
+				db.commit();
+				o["writeMs"] = msBetween(start, Clock::now());
+				o["root"] = toHex(trie.root().ref());
+			}
+			boost::filesystem::remove_all(path);
+			state[toString(a) + "x" + toString(s)] = o;
+		}
+	o_results["state"] = state;
+	return ret;
+}
@@ -0,0 +1,131 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file txpool.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Transaction pool benchmark: filling a block from a big queue.
+ *
+ * Signs a number of value transfers from a number of funded senders, each sender's at consecutive nonces and
+ * random gas prices, and imports them into a queue in a shuffled order. We time the import, the ordering and
+ * State::sync() executing the lot into a pending block, and check nothing was left behind. We also count how often
+ * transactions get decoded and their senders recovered on the way; once each per transaction is all it should take.
+ * Given a capacity below the number of transactions, the queue has to evict; what it keeps should still all execute.
+ */
+
+#include <random>
+#include <libethential/Log.h>
+#include <libethereum/State.h>
+#include <libethereum/TransactionQueue.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+int txpoolBench(Options const& _o, js::mObject& o_results)
+{
+	unsigned senderCount = max(1u, _o.get("senders", 5000));
+	unsigned txCount = max(senderCount, _o.get("txs", 50000));
+	unsigned capacity = _o.get("capacity", txCount);
+	unsigned seed = _o.get("seed", 42);
+
+	js::mObject config;
+	config["senders"] = (int)senderCount;
+	config["txs"] = (int)txCount;
+	config["capacity"] = (int)capacity;
+	o_results["config"] = config;
+
+	mt19937 rng(seed);
+	vector<KeyPair> senders;
+	for (unsigned i = 0; i < senderCount; ++i)
+		senders.push_back(KeyPair::create());
+
+	// Round-robin over the senders so each gets consecutive nonces; priced anywhere from the minimum to ten times it.
+	vector<bytes> txs;
+	vector<u256> nonces(senderCount);
+	uniform_int_distribution<unsigned> price(10, 100);
+	auto signStart = Clock::now();
+	for (unsigned i = 0; i < txCount; ++i)
+	{
+		unsigned s = i % senderCount;
+		Transaction t;
+		t.nonce = nonces[s]++;
+		t.value = 1;
+		t.gasPrice = price(rng) * szabo;
+		t.gas = c_txGas;
+		t.receiveAddress = senders[(s + 1) % senderCount].address();
+		t.sign(senders[s].secret());
+		txs.push_back(t.rlp());
+	}
+	double signMs = msBetween(signStart, Clock::now());
+	shuffle(txs.begin(), txs.end(), rng);
+
+	unsigned decodesBefore = Transaction::decodes();
+	unsigned recoveriesBefore = Transaction::recoveries();
+
+	TransactionQueueLimits limits;
+	limits.count = capacity;
+	limits.bytes = (size_t)-1;
+	limits.perSender = txCount;
+	TransactionQueue tq(limits);
+	auto importStart = Clock::now();
+	unsigned imported = 0;
+	for (auto const& t: txs)
+		imported += tq.import(&t) == ImportResult::Success ? 1 : 0;
+	double importMs = msBetween(importStart, Clock::now());
+	TransactionQueueStatus status = tq.status();
+
+	auto orderStart = Clock::now();
+	auto ordered = tq.ordered();
+	double orderMs = msBetween(orderStart, Clock::now());
+
+	State s(KeyPair::create().address(), OverlayDB());
+	for (auto const& k: senders)
+		s.addBalance(k.address(), u256(1) << 128);
+	bool changed = false;
+	auto syncStart = Clock::now();
+	unsigned included = s.sync(tq, &changed).size();
+	double syncMs = msBetween(syncStart, Clock::now());
+
+	// Should all be in after the one call; a second finds nothing to do.
+	auto resyncStart = Clock::now();
+	unsigned stragglers = s.sync(tq).size();
+	double resyncMs = msBetween(resyncStart, Clock::now());
+
+	unsigned decodes = Transaction::decodes() - decodesBefore;
+	unsigned recoveries = Transaction::recoveries() - recoveriesBefore;
+
+	o_results["signMs"] = signMs;
+	o_results["imported"] = (int)imported;
+	o_results["queued"] = (int)status.current;
+	o_results["evicted"] = (int)status.evicted;
+	o_results["rejected"] = (int)status.rejected;
+	o_results["importMs"] = importMs;
+	o_results["importUsPerTx"] = importMs * 1000 / txCount;
+	o_results["orderMs"] = orderMs;
+	o_results["ordered"] = (int)ordered.size();
+	o_results["included"] = (int)included;
+	o_results["syncMs"] = syncMs;
+	o_results["syncUsPerTx"] = included ? syncMs * 1000 / included : 0;
+	o_results["queueChanged"] = changed;
+	o_results["stragglers"] = (int)stragglers;
+	o_results["resyncMs"] = resyncMs;
+	o_results["decodesPerTx"] = (double)decodes / txCount;
+	o_results["recoveriesPerTx"] = (double)recoveries / txCount;
+
+	return included == status.current && !stragglers ? 0 : 1;
+}
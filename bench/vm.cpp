@@ -0,0 +1,240 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file vm.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * VM benchmark: representative bytecode run straight through VM::go().
+ *
+ * Each workload is a loop over one kind of work: arithmetic, SHA3, memory expansion, storage, and a contract calling
+ * itself to a given depth. Each is run against a trivial in-memory externality, which isolates the interpreter, and
+ * against an ExtVM on an in-memory State, which is what transactions actually pay for. For each we report the time per
+ * instruction, gas per second and heap allocations per run. Keys are sorted, so the output diffs cleanly between commits.
+ */
+
+#include <libethential/Log.h>
+#include <libevm/VM.h>
+#include <libethereum/State.h>
+#include <libethereum/ExtVM.h>
+#include "BenchHelper.h"
+using namespace std;
+using namespace eth;
+using namespace eth::bench;
+namespace js = json_spirit;
+
+namespace
+{
+
+/// Just enough of an externality for the VM: storage in a map, calls that succeed without running anything.
+class BenchExtVM: public ExtVMFace
+{
+public:
+	BenchExtVM(Address _myAddress, bytesConstRef _data, bytesConstRef _code): ExtVMFace(_myAddress, Address(), Address(), 0, 0, _data, _code, BlockInfo(), BlockInfo()) {}
+
+	u256 store(u256 _n) { auto it = m_store.find(_n); return it == m_store.end() ? 0 : it->second; }
+	void setStore(u256 _n, u256 _v) { m_store[_n] = _v; }
+	u256 balance(Address) { return 0; }
+	bool call(Address, u256, bytesConstRef, u256*, bytesRef, OnOpFunc const& = OnOpFunc()) { return true; }
+	h160 create(u256, u256*, bytesConstRef, OnOpFunc const& = OnOpFunc()) { return h160(); }
+
+private:
+	map<u256, u256> m_store;
+};
+
+/// A little assembler, enough for loops.
+struct Code
+{
+	Code& op(Instruction _i) { code.push_back((byte)_i); return *this; }
+	Code& push(u256 _v)
+	{
+		bytes b = toCompactBigEndian(_v);
+		if (b.empty())
+			b.push_back(0);
+		code.push_back((byte)((unsigned)Instruction::PUSH1 + b.size() - 1));
+		code += b;
+		return *this;
+	}
+	/// Loop @a _n times over @a _body, which mustn't disturb the stack beneath it. The counter's on top going in.
+	Code& loop(u256 _n, function<void(Code&)> const& _body)
+	{
+		push(_n);
+		u256 start = code.size();
+		_body(*this);
+		push(1).op(Instruction::SWAP1).op(Instruction::SUB);
+		op(Instruction::DUP1).push(start).op(Instruction::JUMPI).op(Instruction::STOP);
+		return *this;
+	}
+
+	bytes code;
+};
+
+/// Init code that deploys @a _code.
+bytes deployer(bytes const& _code)
+{
+	Code c;
+	c.push(_code.size()).op(Instruction::PUSH1).code.push_back(0);
+	size_t offsetAt = c.code.size() - 1;
+	c.push(0).op(Instruction::CODECOPY).push(_code.size()).push(0).op(Instruction::RETURN);
+	c.code[offsetAt] = (byte)c.code.size();
+	return c.code + _code;
+}
+
+struct Workload
+{
+	string name;
+	bytes code;
+	bytes data;
+};
+
+struct Result
+{
+	uint64_t steps = 0;
+	u256 gas;
+	vector<double> ms;
+	uint64_t allocations = 0;
+};
+
+/// Run the code @a _runs times, having counted its steps and gas once first. @a _with hands a fresh externality to its argument.
+/// VMs come from the pool, as they do for State's calls, so the allocations are those of a warmed-up node.
+template <class Ext> Result measure(unsigned _runs, u256 _gas, function<void(function<void(Ext&)> const&)> const& _with)
+{
+	Result ret;
+	_with([&](Ext& _ext)
+	{
+		VMPool::Lease vm(_gas);
+		vm->go(_ext, [&](uint64_t, Instruction, bigint, bigint, void*, void const*) { ++ret.steps; });
+		ret.gas = _gas - vm->gas();
+	});
+	for (unsigned i = 0; i < _runs; ++i)
+		_with([&](Ext& _ext)
+		{
+			uint64_t allocationsBefore = allocations();
+			auto start = Clock::now();
+			VMPool::Lease vm(_gas);
+			vm->go(_ext);
+			ret.ms.push_back(msBetween(start, Clock::now()));
+			ret.allocations += allocations() - allocationsBefore;
+		});
+	ret.allocations /= _runs;
+	return ret;
+}
+
+js::mObject report(Result const& _r)
+{
+	js::mObject ret;
+	js::mObject ms = summarise(_r.ms);
+	double p50 = ms["p50"].get_real();
+	ret["steps"] = (boost::uint64_t)_r.steps;
+	ret["gas"] = (boost::uint64_t)_r.gas;
+	ret["ms"] = ms;
+	ret["nsPerOp"] = _r.steps ? p50 * 1000000 / _r.steps : 0;
+	ret["gasPerSec"] = p50 ? (double)_r.gas * 1000 / p50 : 0;
+	ret["allocationsPerRun"] = (boost::uint64_t)_r.allocations;
+	return ret;
+}
+
+}
+
+int vmBench(Options const& _o, js::mObject& o_results)
+{
+	unsigned iterations = max(1u, _o.get("iterations", 10000));
+	unsigned depth = max(1u, _o.get("depth", 50));
+	unsigned runs = max(1u, _o.get("runs", 20));
+	u256 gas = u256(1) << 62;
+
+	js::mObject config;
+	config["iterations"] = (int)iterations;
+	config["depth"] = (int)depth;
+	config["runs"] = (int)runs;
+	o_results["config"] = config;
+
+	vector<Workload> workloads;
+	workloads.push_back({ "arithmetic", Code().loop(iterations, [](Code& c)
+	{
+		c.op(Instruction::DUP1).op(Instruction::DUP1).op(Instruction::MUL).push(7).op(Instruction::ADD).op(Instruction::POP);
+	}).code, bytes() });
+	workloads.push_back({ "sha3", Code().loop(iterations, [](Code& c)
+	{
+		c.op(Instruction::DUP1).push(0).op(Instruction::MSTORE).push(32).push(0).op(Instruction::SHA3).op(Instruction::POP);
+	}).code, bytes() });
+	// The counter counts down, so index by how far through we are; memory then grows a word per iteration, not all at once.
+	workloads.push_back({ "memory", Code().loop(iterations, [&](Code& c)
+	{
+		c.op(Instruction::DUP1).op(Instruction::DUP1).push(iterations).op(Instruction::SUB).push(32).op(Instruction::MUL).op(Instruction::MSTORE);
+	}).code, bytes() });
+	workloads.push_back({ "storage", Code().loop(iterations, [](Code& c)
+	{
+		c.op(Instruction::DUP1).op(Instruction::DUP1).op(Instruction::SSTORE).op(Instruction::DUP1).op(Instruction::SLOAD).op(Instruction::POP);
+	}).code, bytes() });
+
+	// Calls itself with one less than the depth it's given, until that's zero.
+	Code calls;
+	calls.push(0).op(Instruction::CALLDATALOAD).op(Instruction::DUP1).op(Instruction::PUSH1).code.push_back(0);
+	size_t continueAt = calls.code.size() - 1;
+	calls.op(Instruction::JUMPI).op(Instruction::STOP);
+	calls.code[continueAt] = (byte)calls.code.size();
+	calls.push(1).op(Instruction::SWAP1).op(Instruction::SUB).push(0).op(Instruction::MSTORE);
+	calls.push(0).push(0).push(32).push(0).push(0).op(Instruction::ADDRESS);
+	calls.op(Instruction::GAS).push(100).op(Instruction::SWAP1).op(Instruction::SUB).op(Instruction::CALL).op(Instruction::POP).op(Instruction::STOP);
+	workloads.push_back({ "calls", calls.code, toBigEndian(u256(depth)) });
+
+	// A State with each workload deployed as a contract, so they can call themselves.
+	KeyPair sender = KeyPair::create();
+	State base(KeyPair::create().address(), OverlayDB());
+	base.addBalance(sender.address(), u256(1) << 128);
+	map<string, Address> addresses;
+	for (auto const& w: workloads)
+	{
+		Transaction t;
+		t.nonce = base.transactionsFrom(sender.address());
+		t.gasPrice = 10 * szabo;
+		t.gas = 100000;
+		t.data = deployer(w.code);
+		t.sign(sender.secret());
+		addresses[w.name] = right160(sha3(rlpList(sender.address(), t.nonce)));
+		base.execute(t.rlp());
+	}
+
+	int ret = 0;
+	for (auto const& w: workloads)
+	{
+		// Had a deployment failed, "calls" would be calling nothing.
+		if (base.code(addresses[w.name]) != w.code)
+			ret = 1;
+
+		js::mObject o;
+		Result fake = measure<BenchExtVM>(runs, gas, [&](function<void(BenchExtVM&)> const& _run)
+		{
+			BenchExtVM ext(addresses[w.name], &w.data, &w.code);
+			_run(ext);
+		});
+		o["fake"] = report(fake);
+
+		Result real = measure<ExtVM>(runs, gas, [&](function<void(ExtVM&)> const& _run)
+		{
+			State s = base;
+			ExtVM ext(s, addresses[w.name], sender.address(), sender.address(), 0, 0, &w.data, &w.code, nullptr);
+			_run(ext);
+		});
+		o["state"] = report(real);
+
+		// The interpreter does the same work either way.
+		if (w.name != "calls" && fake.steps != real.steps)
+			ret = 1;
+		o_results[w.name] = o;
+	}
+	return ret;
+}
@@ -23,6 +23,7 @@
 #if ETH_JSONRPC
 #include "EthStubServer.h"
 #include <libevmface/Instruction.h>
+#include <libevm/VMProfiler.h>
 #include <liblll/Compiler.h>
 #include <libethereum/Client.h>
 #include "CommonJS.h"
@@ -97,6 +98,15 @@ std::string EthStubServer::gasPrice()
 	return "100000000000000";
 }
 
+Json::Value EthStubServer::getWork()
+{
+	Json::Value ret;
+	WorkPackage w = m_client.getWork();
+	ret["headerHash"] = toJS(w.headerHash);
+	ret["boundary"] = toJS(w.boundary);
+	return ret;
+}
+
 bool EthStubServer::isContractAt(const std::string& _a)
 {
 	return m_client.codeAt(jsToAddress(_a), 0).size();
@@ -132,11 +142,87 @@ int EthStubServer::peerCount()
 	return m_client.peerCount();
 }
 
+Json::Value EthStubServer::peers()
+{
+	Json::Value ret(Json::arrayValue);
+	for (PeerInfo const& i: m_client.peers())
+	{
+		Json::Value p;
+		p["clientVersion"] = i.clientVersion;
+		p["host"] = i.host;
+		p["port"] = i.port;
+		p["ping"] = (int)chrono::duration_cast<chrono::milliseconds>(i.lastPing).count();
+		p["latency"] = (int)chrono::duration_cast<chrono::milliseconds>(i.metrics.latency).count();
+		p["bytesIn"] = (Json::UInt64)i.metrics.bytesIn;
+		p["bytesOut"] = (Json::UInt64)i.metrics.bytesOut;
+		p["usefulBlocks"] = i.metrics.usefulBlocks;
+		p["duplicateBlocks"] = i.metrics.duplicateBlocks;
+		p["usefulTransactions"] = i.metrics.usefulTransactions;
+		p["duplicateTransactions"] = i.metrics.duplicateTransactions;
+		p["invalid"] = i.metrics.invalid;
+		p["score"] = i.metrics.score;
+		ret.append(p);
+	}
+	return ret;
+}
+
+Json::Value toJson(VMProfile const& _p)
+{
+	auto entry = [](ProfileEntry const& _e)
+	{
+		Json::Value ret;
+		ret["steps"] = (Json::UInt64)_e.steps;
+		ret["gas"] = toJS((u256)_e.gas);
+		ret["ns"] = (Json::UInt64)_e.ns;
+		return ret;
+	};
+
+	Json::Value ret;
+	Json::Value opcodes(Json::arrayValue);
+	for (unsigned i = 0; i < 256; ++i)
+		if (_p.opcodes[i].steps)
+		{
+			Json::Value o = entry(_p.opcodes[i]);
+			auto info = c_instructionInfo.find((Instruction)i);
+			o["opcode"] = (int)i;
+			o["name"] = info == c_instructionInfo.end() ? string() : info->second.name;
+			opcodes.append(o);
+		}
+	ret["opcodes"] = opcodes;
+
+	Json::Value contracts(Json::arrayValue);
+	for (auto const& i: _p.contracts)
+	{
+		Json::Value c = entry(i.second);
+		c["address"] = toJS(i.first);
+		c["codeHash"] = toJS(i.second.codeHash);
+		c["runs"] = (Json::UInt64)i.second.runs;
+		contracts.append(c);
+	}
+	ret["contracts"] = contracts;
+
+	Json::Value depths(Json::arrayValue);
+	for (auto const& i: _p.depths)
+		depths.append(entry(i));
+	ret["depths"] = depths;
+	return ret;
+}
+
+Json::Value EthStubServer::profile()
+{
+	return toJson(VMProfiler::profile());
+}
+
 std::string EthStubServer::storageAt(const std::string& _a, const std::string& x)
 {
 	return toJS(m_client.stateAt(jsToAddress(_a), jsToU256(x), 0));
 }
 
+bool EthStubServer::submitWork(const std::string& _hash, const std::string& _nonce)
+{
+	return m_client.submitWork(jsToFixed<32>(_hash), jsToFixed<32>(_nonce));
+}
+
 Json::Value EthStubServer::transact(const std::string& _aDest, const std::string& _bData, const std::string& _sec, const std::string& _xGas, const std::string& _xGasPrice, const std::string& _xValue)
 {
 	m_client.transact(jsToSecret(_sec), jsToU256(_xValue), jsToAddress(_aDest), jsToBytes(_bData), jsToU256(_xGas), jsToU256(_xGasPrice));
@@ -30,6 +30,10 @@
 
 namespace eth { class Client; }
 namespace eth { class KeyPair; }
+namespace eth { struct VMProfile; }
+
+/// @returns @a _p as JSON: lists of opcodes, contracts and call depths, each with its steps, gas and time.
+Json::Value toJson(eth::VMProfile const& _p);
 
 class EthStubServer: public AbstractEthStubServer
 {
@@ -42,13 +46,17 @@ public:
 	virtual std::string coinbase();
 	virtual std::string create(const std::string& bCode, const std::string& sec, const std::string& xEndowment, const std::string& xGas, const std::string& xGasPrice);
 	virtual std::string gasPrice();
+	virtual Json::Value getWork();
 	virtual bool isContractAt(const std::string& a);
 	virtual bool isListening();
 	virtual bool isMining();
 	virtual std::string key();
 	virtual Json::Value keys();
 	virtual int peerCount();
+	virtual Json::Value peers();
+	virtual Json::Value profile();
 	virtual std::string storageAt(const std::string& a, const std::string& x);
+	virtual bool submitWork(const std::string& hash, const std::string& nonce);
 	virtual Json::Value transact(const std::string& aDest, const std::string& bData, const std::string& sec, const std::string& xGas, const std::string& xGasPrice, const std::string& xValue);
 	virtual std::string txCountAt(const std::string& a);
 	virtual std::string secretToAddress(const std::string& a);
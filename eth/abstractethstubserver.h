@@ -19,6 +19,7 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
             this->bindAndAddMethod(new jsonrpc::Procedure("coinbase", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING,  NULL), &AbstractEthStubServer::coinbaseI);
             this->bindAndAddMethod(new jsonrpc::Procedure("create", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING, "bCode",jsonrpc::JSON_STRING,"sec",jsonrpc::JSON_STRING,"xEndowment",jsonrpc::JSON_STRING,"xGas",jsonrpc::JSON_STRING,"xGasPrice",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::createI);
             this->bindAndAddMethod(new jsonrpc::Procedure("gasPrice", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING,  NULL), &AbstractEthStubServer::gasPriceI);
+            this->bindAndAddMethod(new jsonrpc::Procedure("getWork", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractEthStubServer::getWorkI);
             this->bindAndAddMethod(new jsonrpc::Procedure("isContractAt", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_BOOLEAN, "a",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::isContractAtI);
             this->bindAndAddMethod(new jsonrpc::Procedure("isListening", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_BOOLEAN,  NULL), &AbstractEthStubServer::isListeningI);
             this->bindAndAddMethod(new jsonrpc::Procedure("isMining", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_BOOLEAN,  NULL), &AbstractEthStubServer::isMiningI);
@@ -27,9 +28,12 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
             this->bindAndAddMethod(new jsonrpc::Procedure("lastBlock", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractEthStubServer::lastBlockI);
             this->bindAndAddMethod(new jsonrpc::Procedure("lll", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING, "s",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::lllI);
             this->bindAndAddMethod(new jsonrpc::Procedure("peerCount", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_INTEGER,  NULL), &AbstractEthStubServer::peerCountI);
+            this->bindAndAddMethod(new jsonrpc::Procedure("peers", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_ARRAY,  NULL), &AbstractEthStubServer::peersI);
             this->bindAndAddMethod(new jsonrpc::Procedure("procedures", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_ARRAY,  NULL), &AbstractEthStubServer::proceduresI);
+            this->bindAndAddMethod(new jsonrpc::Procedure("profile", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,  NULL), &AbstractEthStubServer::profileI);
             this->bindAndAddMethod(new jsonrpc::Procedure("secretToAddress", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING, "a",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::secretToAddressI);
             this->bindAndAddMethod(new jsonrpc::Procedure("storageAt", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING, "a",jsonrpc::JSON_STRING,"x",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::storageAtI);
+            this->bindAndAddMethod(new jsonrpc::Procedure("submitWork", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_BOOLEAN, "hash",jsonrpc::JSON_STRING,"nonce",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::submitWorkI);
             this->bindAndAddMethod(new jsonrpc::Procedure("transact", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT, "aDest",jsonrpc::JSON_STRING,"bData",jsonrpc::JSON_STRING,"sec",jsonrpc::JSON_STRING,"xGas",jsonrpc::JSON_STRING,"xGasPrice",jsonrpc::JSON_STRING,"xValue",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::transactI);
             this->bindAndAddMethod(new jsonrpc::Procedure("txCountAt", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_STRING, "a",jsonrpc::JSON_STRING, NULL), &AbstractEthStubServer::txCountAtI);
 
@@ -65,6 +69,11 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
             response = this->gasPrice();
         }
 
+        inline virtual void getWorkI(const Json::Value& request, Json::Value& response) 
+        {
+            response = this->getWork();
+        }
+
         inline virtual void isContractAtI(const Json::Value& request, Json::Value& response) 
         {
             response = this->isContractAt(request["a"].asString());
@@ -105,11 +114,21 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
             response = this->peerCount();
         }
 
+        inline virtual void peersI(const Json::Value& request, Json::Value& response) 
+        {
+            response = this->peers();
+        }
+
         inline virtual void proceduresI(const Json::Value& request, Json::Value& response) 
         {
             response = this->procedures();
         }
 
+        inline virtual void profileI(const Json::Value& request, Json::Value& response) 
+        {
+            response = this->profile();
+        }
+
         inline virtual void secretToAddressI(const Json::Value& request, Json::Value& response) 
         {
             response = this->secretToAddress(request["a"].asString());
@@ -120,6 +139,11 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
             response = this->storageAt(request["a"].asString(), request["x"].asString());
         }
 
+        inline virtual void submitWorkI(const Json::Value& request, Json::Value& response) 
+        {
+            response = this->submitWork(request["hash"].asString(), request["nonce"].asString());
+        }
+
         inline virtual void transactI(const Json::Value& request, Json::Value& response) 
         {
             response = this->transact(request["aDest"].asString(), request["bData"].asString(), request["sec"].asString(), request["xGas"].asString(), request["xGasPrice"].asString(), request["xValue"].asString());
@@ -137,6 +161,7 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
         virtual std::string coinbase() = 0;
         virtual std::string create(const std::string& bCode, const std::string& sec, const std::string& xEndowment, const std::string& xGas, const std::string& xGasPrice) = 0;
         virtual std::string gasPrice() = 0;
+        virtual Json::Value getWork() = 0;
         virtual bool isContractAt(const std::string& a) = 0;
         virtual bool isListening() = 0;
         virtual bool isMining() = 0;
@@ -145,9 +170,12 @@ class AbstractEthStubServer : public jsonrpc::AbstractServer<AbstractEthStubServ
         virtual Json::Value lastBlock() = 0;
         virtual std::string lll(const std::string& s) = 0;
         virtual int peerCount() = 0;
+        virtual Json::Value peers() = 0;
         virtual Json::Value procedures() = 0;
+        virtual Json::Value profile() = 0;
         virtual std::string secretToAddress(const std::string& a) = 0;
         virtual std::string storageAt(const std::string& a, const std::string& x) = 0;
+        virtual bool submitWork(const std::string& hash, const std::string& nonce) = 0;
         virtual Json::Value transact(const std::string& aDest, const std::string& bData, const std::string& sec, const std::string& xGas, const std::string& xGasPrice, const std::string& xValue) = 0;
         virtual std::string txCountAt(const std::string& a) = 0;
 
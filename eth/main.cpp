@@ -80,6 +80,7 @@ void interactiveHelp()
 		<< "    send  Execute a given transaction with current secret." << endl
 		<< "    contract  Create a new contract with current secret." << endl
 		<< "    peers  List the peers that are connected" << endl
+		<< "    txqueue  Gives the state of the transaction queue." << endl
 		<< "    listAccounts  List the accounts on the network." << endl
 		<< "    listContracts  List the contracts on the network." << endl
 		<< "    setSecret <secret>  Set the secret to the hex secret key." <<endl
@@ -88,6 +89,7 @@ void interactiveHelp()
 		<< "    importConfig <path>  Import the config (.RLP) from the path provided." <<endl
 		<< "    inspect <contract>  Dumps a contract to <APPDATA>/<contract>.evm." << endl
 		<< "    dumptrace <block> <index> <filename> <format>  Dumps a transaction trace" << endl << "to <filename>. <format> should be one of pretty, standard, standard+." << endl
+		<< "    profile (on|off|reset|json)  Switches VM profiling on or off, clears it, or shows it as a table or JSON." << endl
 		<< "    exit  Exits the application." << endl;
 }
 
@@ -103,6 +105,8 @@ void help()
 		<< "    -f,--force-mining  Mine even when there are no transaction to mine (Default: off)" << endl
 		<< "    -h,--help  Show this help message and exit." << endl
         << "    -i,--interactive  Enter interactive mode (default: non-interactive)." << endl
+		<< "    --import-threads <n>  Execute imported blocks' transactions on n threads; 0 for one per hardware thread (Default: 1)." << endl
+		<< "    --profile  Profile the VM's cost per opcode, contract and call depth from the start (default: off)." << endl
 #if ETH_JSONRPC
 		<< "    -j,--json-rpc  Enable JSON-RPC server (default: off)." << endl
 		<< "    --json-rpc-port  Specify JSON-RPC server port (implies '-j', default: 8080)." << endl
@@ -114,6 +118,7 @@ void help()
         << "    -p,--port <port>  Connect to remote port (default: 30303)." << endl
         << "    -r,--remote <host>  Connect to remote host (default: none)." << endl
         << "    -s,--secret <secretkeyhex>  Set the secret key for use with send command (default: auto)." << endl
+		<< "    -t,--mining-threads <n>  Mine with n threads; 0 for one per hardware thread (Default: 1)." << endl
         << "    -u,--public-ip <ip>  Force public ip to given (default; auto)." << endl
         << "    -v,--verbosity <0 - 9>  Set the log verbosity from 0 to 9 (Default: 8)." << endl
         << "    -x,--peers <number>  Attempt to connect to given number of peers (Default: 5)." << endl
@@ -187,6 +192,8 @@ int main(int argc, char** argv)
 	string publicIP;
 	bool upnp = true;
 	bool forceMining = false;
+	unsigned miningThreads = 1;
+	unsigned importThreads = 1;
 	string clientName;
 
 	// Init defaults
@@ -260,6 +267,12 @@ int main(int argc, char** argv)
 		}
 		else if (arg == "-f" || arg == "--force-mining")
 			forceMining = true;
+		else if ((arg == "-t" || arg == "--mining-threads") && i + 1 < argc)
+			miningThreads = atoi(argv[++i]);
+		else if (arg == "--import-threads" && i + 1 < argc)
+			importThreads = atoi(argv[++i]);
+		else if (arg == "--profile")
+			VMProfiler::setEnabled(true);
 		else if (arg == "-i" || arg == "--interactive")
 			interactive = true;
 #if ETH_JSONRPC
@@ -303,6 +316,8 @@ int main(int argc, char** argv)
 	cout << credits();
 
 	c.setForceMining(forceMining);
+	c.setMiningThreads(miningThreads);
+	c.setImportThreads(importThreads);
 
 	cout << "Address: " << endl << toHex(us.address().asArray()) << endl;
 	c.startNetwork(listenPort, remoteHost, remotePort, mode, peers, publicIP, upnp);
@@ -424,9 +439,18 @@ int main(int argc, char** argv)
 			{
 				for (auto it: c.peers())
 					cout << it.host << ":" << it.port << ", " << it.clientVersion << ", "
-						<< std::chrono::duration_cast<std::chrono::milliseconds>(it.lastPing).count() << "ms"
+						<< std::chrono::duration_cast<std::chrono::milliseconds>(it.lastPing).count() << "ms, "
+						<< "score " << it.metrics.score << " (" << it.metrics.usefulBlocks << "/" << it.metrics.duplicateBlocks << " blocks, "
+						<< it.metrics.usefulTransactions << "/" << it.metrics.duplicateTransactions << " txs useful/dup, "
+						<< it.metrics.invalid << " bad, " << it.metrics.bytesIn << "B in, " << it.metrics.bytesOut << "B out)"
 						<< endl;
 			}
+			else if (cmd == "txqueue")
+			{
+				auto s = c.transactionQueueStatus();
+				cout << s.current << " transactions (" << s.bytes << "B) from " << s.senders << " senders queued; "
+					<< s.admitted << " admitted, " << s.rejected << " rejected, " << s.evicted << " evicted, " << s.malformed << " malformed" << endl;
+			}
 			else if (cmd == "balance")
 			{
 				cout << "Current balance: " << formatBalance(c.balanceAt(us.address())) << " = " << c.balanceAt(us.address()) << " wei" << endl;
@@ -630,6 +654,21 @@ int main(int argc, char** argv)
 						});
 				}
 			}
+			else if (cmd == "profile")
+			{
+				string what;
+				iss >> what;
+				if (what == "on" || what == "off")
+					VMProfiler::setEnabled(what == "on");
+				else if (what == "reset")
+					VMProfiler::reset();
+#if ETH_JSONRPC
+				else if (what == "json")
+					cout << Json::StyledWriter().write(toJson(VMProfiler::profile()));
+#endif
+				else
+					cout << "Profiling " << (VMProfiler::enabled() ? "on" : "off") << endl << VMProfiler::profile();
+			}
 			else if (cmd == "inspect")
 			{
 				string rechex;
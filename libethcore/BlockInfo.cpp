@@ -57,7 +57,11 @@ h256 BlockInfo::headerHashWithoutNonce() const
 
 void BlockInfo::fillStream(RLPStream& _s, bool _nonce) const
 {
-	_s.appendList(_nonce ? 13 : 12) << parentHash << sha3Uncles << coinbaseAddress;
+	uint payload = rlpSize(parentHash) + rlpSize(sha3Uncles) + rlpSize(coinbaseAddress) + rlpSize(stateRoot, false, true) + rlpSize(transactionsRoot, false, true)
+		+ rlpSize(difficulty) + rlpSize(number) + rlpSize(minGasPrice) + rlpSize(gasLimit) + rlpSize(gasUsed) + rlpSize(timestamp) + rlpSize(extraData);
+	if (_nonce)
+		payload += rlpSize(nonce);
+	_s.appendList(_nonce ? 13 : 12, payload) << parentHash << sha3Uncles << coinbaseAddress;
 	_s.append(stateRoot, false, true).append(transactionsRoot, false, true);
 	_s << difficulty << number << minGasPrice << gasLimit << gasUsed << timestamp << extraData;
 	if (_nonce)
@@ -69,19 +73,20 @@ void BlockInfo::populateFromHeader(RLP const& _header, bool _checkNonce)
 	int field = 0;
 	try
 	{
-		parentHash = _header[field = 0].toHash<h256>();
-		sha3Uncles = _header[field = 1].toHash<h256>();
-		coinbaseAddress = _header[field = 2].toHash<Address>();
-		stateRoot = _header[field = 3].toHash<h256>();
-		transactionsRoot = _header[field = 4].toHash<h256>();
-		difficulty = _header[field = 5].toInt<u256>();
-		number = _header[field = 6].toInt<u256>();
-		minGasPrice = _header[field = 7].toInt<u256>();
-		gasLimit = _header[field = 8].toInt<u256>();
-		gasUsed = _header[field = 9].toInt<u256>();
-		timestamp = _header[field = 10].toInt<u256>();
-		extraData = _header[field = 11].toBytes();
-		nonce = _header[field = 12].toHash<h256>();
+		RLPView header(_header);
+		parentHash = header[field = 0].toHash<h256>();
+		sha3Uncles = header[field = 1].toHash<h256>();
+		coinbaseAddress = header[field = 2].toHash<Address>();
+		stateRoot = header[field = 3].toHash<h256>();
+		transactionsRoot = header[field = 4].toHash<h256>();
+		difficulty = header[field = 5].toInt<u256>();
+		number = header[field = 6].toInt<u256>();
+		minGasPrice = header[field = 7].toInt<u256>();
+		gasLimit = header[field = 8].toInt<u256>();
+		gasUsed = header[field = 9].toInt<u256>();
+		timestamp = header[field = 10].toInt<u256>();
+		extraData = header[field = 11].toBytes();
+		nonce = header[field = 12].toHash<h256>();
 	}
 	catch (RLPException const&)
 	{
@@ -26,6 +26,7 @@
 #include <array>
 #include <random>
 #include <thread>
+#include <boost/thread.hpp>
 #include <libethcore/CryptoHeaders.h>
 #include <libethential/Common.h>
 #include "Dagger.h"
@@ -37,33 +38,117 @@ namespace eth
 
 #if FAKE_DAGGER
 
-MineInfo Dagger::mine(h256& o_solution, h256 const& _root, u256 const& _difficulty, uint _msTimeout, bool _continue, bool _turbo)
+bool Dagger::verify(h256 const& _root, h256 const& _nonce, u256 const& _difficulty)
 {
-	MineInfo ret{0.f, 1e99, 0, false};
+#if ALL_COMPILERS_ARE_CPP11_COMPLIANT
+	static thread_local pair<bool, u256> s_difficulty(false, 0);	// Whether we've a boundary yet and for which difficulty.
+	static thread_local h256 s_boundary;
+#else
+	static boost::thread_specific_ptr<pair<bool, u256>> t_difficulty;
+	static boost::thread_specific_ptr<h256> t_boundary;
+	if (!t_difficulty.get())
+	{
+		t_difficulty.reset(new pair<bool, u256>(false, 0));
+		t_boundary.reset(new h256);
+	}
+	pair<bool, u256>& s_difficulty = *t_difficulty;	// Whether we've a boundary yet and for which difficulty.
+	h256& s_boundary = *t_boundary;
+#endif
+	if (!s_difficulty.first || _difficulty != s_difficulty.second)
+	{
+		s_boundary = boundary(_difficulty);
+		s_difficulty = make_pair(true, _difficulty);
+	}
+	// Big-endian, so comparing the bytes is comparing the numbers.
+	return !(s_boundary < eval(_root, _nonce));
+}
+
+/// Add one to @a _h, taken as a big-endian number.
+static inline void increment(h256& _h)
+{
+	for (unsigned i = 32; i-- && !++_h[i];) {}
+}
+
+MineInfo Dagger::mine(h256& o_solution, h256 const& _root, u256 const& _difficulty, uint _msTimeout, bool _continue, bool _turbo, unsigned _threads, std::atomic<bool> const* _abort)
+{
+	MineInfo ret{0.f, 1e99, 0, false, 0};
 	static std::mt19937_64 s_eng((time(0) + (unsigned)m_last));
 	u256 s = (m_last = h256::random(s_eng));
 
-	bigint d = (bigint(1) << 256) / _difficulty;
-	ret.requirement = log2((double)d);
+	u256 const b = boundary(_difficulty);
+	h256 const bh = b;
+	ret.requirement = log2((double)b);
+
+	auto aborted = [&]() { return !_continue || (_abort && _abort->load(std::memory_order_relaxed)); };
 
 	// 2^ 0      32      64      128      256
 	//   [--------*-------------------------]
 	//
-	// evaluate until we run out of time
+	// evaluate until we run out of time, napping first unless in turbo mode
 	auto startTime = steady_clock::now();
+	auto deadline = startTime + milliseconds(_msTimeout);
 	if (!_turbo)
-		this_thread::sleep_for(chrono::milliseconds(_msTimeout * 90 / 100));
-	for (; (steady_clock::now() - startTime) < milliseconds(_msTimeout) && _continue; s++, ret.hashes++)
+		for (auto wake = startTime + milliseconds(_msTimeout * 90 / 100); !aborted() && steady_clock::now() < wake;)
+			this_thread::sleep_for(min<steady_clock::duration>(wake - steady_clock::now(), milliseconds(10)));
+
+	// The root is the same for every attempt, so it's absorbed once. Nonces are then hashed and compared a
+	// batch at a time, all as big-endian hashes so nothing per attempt goes near the arithmetic types. We
+	// only look at the clock & flags between batches; they cost more than a hash.
+	SHA3Midstate const hasher(_root);
+	static const unsigned c_batch = 256;
+	unsigned threads = max(1u, _threads);
+	std::atomic<bool> found(false);
+	vector<uint> hashes(threads, 0);
+	vector<h256> best(threads);
+	auto search = [&](unsigned _i)
 	{
-		o_solution = (h256)s;
-		auto e = (bigint)(u256)eval(_root, o_solution);
-		ret.best = min<double>(ret.best, log2((double)e));
-		if (e <= d)
+		// Worker i starts i * 2^192 along from the random start, so slices never overlap in practice.
+		h256 n = s + (u256(_i) << 192);
+		h256 bestHere = ~u256(0);
+		uint count = 0;
+		array<h256, c_batch> nonces;
+		array<h256, c_batch> evals;
+		while (!found.load(std::memory_order_relaxed) && !aborted() && steady_clock::now() < deadline)
 		{
-			ret.completed = true;
-			break;
+			for (auto& i: nonces)
+			{
+				i = n;
+				increment(n);
+			}
+			hasher(nonces.data(), c_batch, evals.data());
+			count += c_batch;
+			for (unsigned j = 0; j < c_batch; ++j)
+			{
+				if (evals[j] < bestHere)
+					bestHere = evals[j];
+				if (!(bh < evals[j]))
+				{
+					bool expected = false;
+					if (found.compare_exchange_strong(expected, true))
+						o_solution = nonces[j];
+					break;
+				}
+			}
 		}
-	}
+		hashes[_i] = count;
+		best[_i] = bestHere;
+	};
+
+	vector<thread> workers;
+	for (unsigned i = 1; i < threads; ++i)
+		workers.push_back(thread(search, i));
+	search(0);
+	for (auto& w: workers)
+		w.join();
+
+	ret.completed = found;
+	for (unsigned i = 0; i < threads; ++i)
+		if (hashes[i])
+		{
+			ret.hashes += hashes[i];
+			ret.best = min<double>(ret.best, log2((double)(u256)best[i]));
+		}
+	ret.ms = (uint)duration_cast<milliseconds>(steady_clock::now() - startTime).count();
 
 	if (ret.completed)
 		assert(verify(_root, o_solution, _difficulty));
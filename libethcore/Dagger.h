@@ -23,6 +23,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <libethcore/SHA3.h>
 #include "CommonEth.h"
 
@@ -42,6 +43,7 @@ struct MineInfo
 	double best;
 	uint hashes;
 	bool completed;
+	uint ms;			///< How long the call actually took, sleeping included.
 };
 
 #if FAKE_DAGGER
@@ -50,9 +52,16 @@ class Dagger
 {
 public:
 	static h256 eval(h256 const& _root, h256 const& _nonce) { h256 b[2] = { _root, _nonce }; return sha3(bytesConstRef((byte const*)&b[0], 64)); }
-	static bool verify(h256 const& _root, h256 const& _nonce, u256 const& _difficulty) { return (bigint)(u256)eval(_root, _nonce) <= (bigint(1) << 256) / _difficulty; }
-
-	MineInfo mine(h256& o_solution, h256 const& _root, u256 const& _difficulty, uint _msTimeout = 100, bool _continue = true, bool _turbo = false);
+	/// @returns true iff @a _nonce satisfies @a _difficulty. The boundary of the last difficulty seen is kept, so
+	/// checking a run of blocks of the same difficulty needs no division.
+	static bool verify(h256 const& _root, h256 const& _nonce, u256 const& _difficulty);
+	/// @returns the largest eval() that satisfies @a _difficulty, i.e. 2^256 / _difficulty, saturated to fit a u256.
+	static u256 boundary(u256 const& _difficulty) { return _difficulty > 1 ? (u256)((bigint(1) << 256) / _difficulty) : ~u256(0); }
+
+	/// Search for a nonce satisfying @a _difficulty for up to @a _msTimeout milliseconds.
+	/// @param _threads Number of threads to search with; each gets its own disjoint slice of the nonce space.
+	/// @param _abort If given, the search gives up as soon as this becomes true.
+	MineInfo mine(h256& o_solution, h256 const& _root, u256 const& _difficulty, uint _msTimeout = 100, bool _continue = true, bool _turbo = false, unsigned _threads = 1, std::atomic<bool> const* _abort = nullptr);
 
 	h256 m_last;
 };
@@ -17,14 +17,200 @@
 /** @file SHA3.cpp
  * @author Gav Wood <i@gavwood.com>
  * @date 2014
+ *
+ * Keccak-256, as submitted to the SHA-3 competition (i.e. before NIST changed the padding).
  */
 
 #include "SHA3.h"
-#include "CryptoHeaders.h"
+#include <cstring>
 
 using namespace std;
 using namespace eth;
 
+namespace
+{
+
+/// Bytes of input absorbed per permutation for a 256-bit output.
+static const unsigned c_rate = 136;
+
+static const uint64_t c_roundConstants[24] =
+{
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+#define ETH_ROL64(X, N) (((X) << (N)) | ((X) >> (64 - (N))))
+
+/// The Keccak-f[1600] permutation. @a L is either a single 64-bit lane or a vector of lanes from
+/// independent states, in which case they're all permuted at once. Written out longhand so it's
+/// fast without relying on the optimiser to unroll it.
+template <class L> inline void keccakF(L* _a)
+{
+	for (unsigned r = 0; r < 24; ++r)
+	{
+		// Theta
+		L c0 = _a[0] ^ _a[5] ^ _a[10] ^ _a[15] ^ _a[20];
+		L c1 = _a[1] ^ _a[6] ^ _a[11] ^ _a[16] ^ _a[21];
+		L c2 = _a[2] ^ _a[7] ^ _a[12] ^ _a[17] ^ _a[22];
+		L c3 = _a[3] ^ _a[8] ^ _a[13] ^ _a[18] ^ _a[23];
+		L c4 = _a[4] ^ _a[9] ^ _a[14] ^ _a[19] ^ _a[24];
+		L d0 = c4 ^ ETH_ROL64(c1, 1);
+		L d1 = c0 ^ ETH_ROL64(c2, 1);
+		L d2 = c1 ^ ETH_ROL64(c3, 1);
+		L d3 = c2 ^ ETH_ROL64(c4, 1);
+		L d4 = c3 ^ ETH_ROL64(c0, 1);
+		for (unsigned y = 0; y < 25; y += 5)
+		{
+			_a[y] ^= d0;
+			_a[y + 1] ^= d1;
+			_a[y + 2] ^= d2;
+			_a[y + 3] ^= d3;
+			_a[y + 4] ^= d4;
+		}
+
+		// Rho and pi: each lane rotated and moved on, following lane 1 around.
+		L t = _a[1], u;
+		u = _a[10]; _a[10] = ETH_ROL64(t, 1); t = u;
+		u = _a[7]; _a[7] = ETH_ROL64(t, 3); t = u;
+		u = _a[11]; _a[11] = ETH_ROL64(t, 6); t = u;
+		u = _a[17]; _a[17] = ETH_ROL64(t, 10); t = u;
+		u = _a[18]; _a[18] = ETH_ROL64(t, 15); t = u;
+		u = _a[3]; _a[3] = ETH_ROL64(t, 21); t = u;
+		u = _a[5]; _a[5] = ETH_ROL64(t, 28); t = u;
+		u = _a[16]; _a[16] = ETH_ROL64(t, 36); t = u;
+		u = _a[8]; _a[8] = ETH_ROL64(t, 45); t = u;
+		u = _a[21]; _a[21] = ETH_ROL64(t, 55); t = u;
+		u = _a[24]; _a[24] = ETH_ROL64(t, 2); t = u;
+		u = _a[4]; _a[4] = ETH_ROL64(t, 14); t = u;
+		u = _a[15]; _a[15] = ETH_ROL64(t, 27); t = u;
+		u = _a[23]; _a[23] = ETH_ROL64(t, 41); t = u;
+		u = _a[19]; _a[19] = ETH_ROL64(t, 56); t = u;
+		u = _a[13]; _a[13] = ETH_ROL64(t, 8); t = u;
+		u = _a[12]; _a[12] = ETH_ROL64(t, 25); t = u;
+		u = _a[2]; _a[2] = ETH_ROL64(t, 43); t = u;
+		u = _a[20]; _a[20] = ETH_ROL64(t, 62); t = u;
+		u = _a[14]; _a[14] = ETH_ROL64(t, 18); t = u;
+		u = _a[22]; _a[22] = ETH_ROL64(t, 39); t = u;
+		u = _a[9]; _a[9] = ETH_ROL64(t, 61); t = u;
+		u = _a[6]; _a[6] = ETH_ROL64(t, 20); t = u;
+		_a[1] = ETH_ROL64(t, 44);
+
+		// Chi
+		for (unsigned y = 0; y < 25; y += 5)
+		{
+			L b0 = _a[y], b1 = _a[y + 1], b2 = _a[y + 2], b3 = _a[y + 3], b4 = _a[y + 4];
+			_a[y] = b0 ^ (~b1 & b2);
+			_a[y + 1] = b1 ^ (~b2 & b3);
+			_a[y + 2] = b2 ^ (~b3 & b4);
+			_a[y + 3] = b3 ^ (~b4 & b0);
+			_a[y + 4] = b4 ^ (~b0 & b1);
+		}
+
+		// Iota
+		_a[0] ^= c_roundConstants[r];
+	}
+}
+
+inline uint64_t load64(byte const* _p)
+{
+	uint64_t ret = 0;
+	for (unsigned i = 8; i--;)
+		ret = (ret << 8) | _p[i];
+	return ret;
+}
+
+inline void store64(byte* _p, uint64_t _v)
+{
+	for (unsigned i = 0; i < 8; ++i, _v >>= 8)
+		_p[i] = (byte)_v;
+}
+
+/// Fills @a o_block with the last, padded, block of @a _input.
+void finalBlock(bytesConstRef _input, byte* o_block)
+{
+	unsigned tail = _input.size() % c_rate;
+	memset(o_block, 0, c_rate);
+	if (tail)
+		memcpy(o_block, _input.data() + _input.size() - tail, tail);
+	o_block[tail] ^= 0x01;
+	o_block[c_rate - 1] ^= 0x80;
+}
+
+void keccak256(bytesConstRef _input, byte* o_output)
+{
+	uint64_t a[25] = {};
+	byte const* in = _input.data();
+	for (size_t n = _input.size() / c_rate; n--; in += c_rate)
+	{
+		for (unsigned i = 0; i < c_rate / 8; ++i)
+			a[i] ^= load64(in + i * 8);
+		keccakF(a);
+	}
+	byte last[c_rate];
+	finalBlock(_input, last);
+	for (unsigned i = 0; i < c_rate / 8; ++i)
+		a[i] ^= load64(last + i * 8);
+	keccakF(a);
+	for (unsigned i = 0; i < 4; ++i)
+		store64(o_output + i * 8, a[i]);
+}
+
+#if defined(__GNUC__)
+
+// As wide as the target's vector units go; where they're narrower than this (e.g. plain SSE2) the
+// compiler splits each operation, which still beats doing one state at a time.
+#if defined(__AVX512F__)
+typedef uint64_t KeccakLanes __attribute__((vector_size(64)));
+#else
+typedef uint64_t KeccakLanes __attribute__((vector_size(32)));
+#endif
+static const unsigned c_lanes = sizeof(KeccakLanes) / sizeof(uint64_t);
+
+/// Hashes @a _count (at most c_lanes) inputs at once, one per lane.
+void keccak256Lanes(bytesConstRef const* _inputs, unsigned _count, h256* o_outputs)
+{
+	KeccakLanes a[25];
+	memset(a, 0, sizeof(a));
+	size_t blocks[c_lanes];
+	size_t mostBlocks = 0;
+	for (unsigned l = 0; l < _count; ++l)
+		mostBlocks = max(mostBlocks, blocks[l] = _inputs[l].size() / c_rate + 1);
+
+	byte last[c_rate];
+	for (size_t b = 0; b < mostBlocks; ++b)
+	{
+		for (unsigned l = 0; l < _count; ++l)
+		{
+			byte const* in;
+			if (b + 1 < blocks[l])
+				in = _inputs[l].data() + b * c_rate;
+			else if (b + 1 == blocks[l])
+			{
+				finalBlock(_inputs[l], last);
+				in = last;
+			}
+			else
+				// Done with this one; its lane goes round with the others but is ignored.
+				continue;
+			for (unsigned i = 0; i < c_rate / 8; ++i)
+				a[i][l] ^= load64(in + i * 8);
+		}
+		keccakF(a);
+		for (unsigned l = 0; l < _count; ++l)
+			if (b + 1 == blocks[l])
+				for (unsigned i = 0; i < 4; ++i)
+					store64(o_outputs[l].data() + i * 8, a[i][l]);
+	}
+}
+
+#endif
+
+}
+
 h256 eth::EmptySHA3 = sha3(bytesConstRef());
 
 std::string eth::sha3(std::string const& _input, bool _hex)
@@ -46,10 +232,67 @@ std::string eth::sha3(std::string const& _input, bool _hex)
 
 void eth::sha3(bytesConstRef _input, bytesRef _output)
 {
-	CryptoPP::SHA3_256 ctx;
-	ctx.Update((byte*)_input.data(), _input.size());
 	assert(_output.size() >= 32);
-	ctx.Final(_output.data());
+	keccak256(_input, _output.data());
+}
+
+SHA3Midstate::SHA3Midstate(h256 const& _prefix)
+{
+	memset(m_state, 0, sizeof(m_state));
+	for (unsigned i = 0; i < 4; ++i)
+		m_state[i] = load64(_prefix.data() + i * 8);
+	// The padding: right after the suffix, and at the very end of the block.
+	m_state[8] = 0x01;
+	m_state[c_rate / 8 - 1] = 0x8000000000000000ULL;
+}
+
+h256 SHA3Midstate::operator()(h256 const& _suffix) const
+{
+	uint64_t a[25];
+	memcpy(a, m_state, sizeof(a));
+	for (unsigned i = 0; i < 4; ++i)
+		a[4 + i] = load64(_suffix.data() + i * 8);
+	keccakF(a);
+	h256 ret;
+	for (unsigned i = 0; i < 4; ++i)
+		store64(ret.data() + i * 8, a[i]);
+	return ret;
+}
+
+void SHA3Midstate::operator()(h256 const* _suffixes, unsigned _count, h256* o_outputs) const
+{
+	unsigned i = 0;
+#if defined(__GNUC__)
+	for (; i + 1 < _count; i += c_lanes)
+	{
+		unsigned n = min(c_lanes, _count - i);
+		KeccakLanes a[25];
+		for (unsigned j = 0; j < 25; ++j)
+			for (unsigned l = 0; l < c_lanes; ++l)
+				a[j][l] = m_state[j];
+		for (unsigned l = 0; l < n; ++l)
+			for (unsigned j = 0; j < 4; ++j)
+				a[4 + j][l] = load64(_suffixes[i + l].data() + j * 8);
+		keccakF(a);
+		for (unsigned l = 0; l < n; ++l)
+			for (unsigned j = 0; j < 4; ++j)
+				store64(o_outputs[i + l].data() + j * 8, a[j][l]);
+	}
+#endif
+	for (; i < _count; ++i)
+		o_outputs[i] = (*this)(_suffixes[i]);
+}
+
+void eth::sha3(std::vector<bytesConstRef> const& _inputs, h256* o_outputs)
+{
+	unsigned i = 0;
+#if defined(__GNUC__)
+	// A lone straggler isn't worth a vector permutation.
+	for (; i + 1 < _inputs.size(); i += c_lanes)
+		keccak256Lanes(_inputs.data() + i, min<size_t>(c_lanes, _inputs.size() - i), o_outputs + i);
+#endif
+	for (; i < _inputs.size(); ++i)
+		keccak256(_inputs[i], o_outputs[i].data());
 }
 
 bytes eth::sha3Bytes(bytesConstRef _input)
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <libethential/FixedHash.h>
 #include <libethential/vector_ref.h>
 
@@ -56,6 +57,32 @@ inline h256 sha3(bytes const& _input) { return sha3(bytesConstRef((bytes*)&_inpu
 /// Calculate SHA3-256 hash of the given input (presented as a binary-filled string), returning as a 256-bit hash.
 inline h256 sha3(std::string const& _input) { return sha3(bytesConstRef(_input)); }
 
+/// Calculate SHA3-256 hashes of each of the given independent inputs, placing them in @a o_outputs, which
+/// must have room for as many. Inputs are hashed several at a time in the vector units where available.
+void sha3(std::vector<bytesConstRef> const& _inputs, h256* o_outputs);
+
+/// Calculate SHA3-256 hashes of each of the given independent inputs.
+inline std::vector<h256> sha3(std::vector<bytesConstRef> const& _inputs) { std::vector<h256> ret(_inputs.size()); sha3(_inputs, ret.data()); return ret; }
+
+/// SHA3-256 of a constant 32-byte prefix followed by a varying 32-byte suffix, e.g. a header hash followed by
+/// candidate nonces. 64 bytes fit in a single block, so the prefix and the padding are laid into the state once
+/// and each hash is then just the suffix and one permutation.
+class SHA3Midstate
+{
+public:
+	explicit SHA3Midstate(h256 const& _prefix);
+
+	/// @returns the SHA3-256 of the prefix followed by @a _suffix.
+	h256 operator()(h256 const& _suffix) const;
+
+	/// Hash the prefix followed by each of @a _count @a _suffixes into @a o_outputs, several at a time in the
+	/// vector units where available.
+	void operator()(h256 const* _suffixes, unsigned _count, h256* o_outputs) const;
+
+private:
+	uint64_t m_state[25];	///< The state before the permutation, with the suffix lanes left zero.
+};
+
 extern h256 EmptySHA3;
 
 }
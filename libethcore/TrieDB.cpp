@@ -32,4 +32,100 @@ namespace eth
 const h256 c_shaNull = sha3(rlp(""));
 
 #endif
+
+namespace
+{
+
+/// @returns the RLP of the trie node holding [_begin, _end), all of whose keys share the first @a _preLen nibbles.
+bytes trieNode(HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen);
+
+/// Appends the nodes @a _children to @a _rlp, inline if they're small enough and otherwise by hash, hashing
+/// them all in one go. Empty children are appended as the empty string.
+void appendChildren(std::vector<bytes> const& _children, RLPStream& _rlp)
+{
+	std::vector<bytesConstRef> big;
+	for (auto const& c: _children)
+		if (c.size() >= 32)
+			big.push_back(&c);
+	std::vector<h256> hashes = sha3(big);
+	unsigned h = 0;
+	for (auto const& c: _children)
+		if (c.empty())
+			_rlp << "";
+		else if (c.size() < 32)
+			_rlp.appendRaw(c);
+		else
+			_rlp << hashes[h++];
+}
+
+bytes trieNode(HexMap::const_iterator _begin, HexMap::const_iterator _end, unsigned _preLen)
+{
+	RLPStream rlp;
+	if (std::next(_begin) == _end)
+		// only one left - terminate with the pair.
+		rlp.appendList(2) << hexPrefixEncode(_begin->first, true, _preLen) << _begin->second;
+	else
+	{
+		// find the number of nibbles all the keys share.
+		unsigned sharedPre = (unsigned)-1;
+		for (auto i = std::next(_begin); i != _end && sharedPre; ++i)
+		{
+			unsigned x = std::min<unsigned>(sharedPre, std::min(_begin->first.size(), i->first.size()));
+			unsigned shared = _preLen;
+			for (; shared < x && _begin->first[shared] == i->first[shared]; ++shared) {}
+			sharedPre = std::min(shared, sharedPre);
+		}
+		if (sharedPre > _preLen)
+		{
+			// if they all have the same next nibble, we want an extension.
+			rlp.appendList(2) << hexPrefixEncode(_begin->first, false, _preLen, (int)sharedPre);
+			appendChildren({ trieNode(_begin, _end, sharedPre) }, rlp);
+		}
+		else
+		{
+			// otherwise a branch of all 16+1 entries.
+			rlp.appendList(17);
+			auto b = _begin;
+			if (_preLen == b->first.size())
+				++b;
+			std::vector<bytes> children(16);
+			for (unsigned i = 0; i < 16; ++i)
+			{
+				auto n = b;
+				for (; n != _end && n->first[_preLen] == i; ++n) {}
+				if (b != n)
+					children[i] = trieNode(b, n, _preLen + 1);
+				b = n;
+			}
+			appendChildren(children, rlp);
+			if (_preLen == _begin->first.size())
+				rlp << _begin->second;
+			else
+				rlp << "";
+		}
+	}
+	return rlp.out();
+}
+
+}
+
+h256 trieRoot(StringMap const& _s)
+{
+	if (_s.empty())
+		return h256();
+	HexMap hexMap;
+	for (auto const& i: _s)
+		hexMap[asNibbles(i.first)] = i.second;
+	return sha3(trieNode(hexMap.cbegin(), hexMap.cend(), 0));
+}
+
+h256 orderedTrieRoot(std::vector<bytes> const& _data)
+{
+	StringMap s;
+	unsigned j = 0;
+	for (auto const& i: _data)
+		s[asString(rlp(j++))] = asString(i);
+	return trieRoot(s);
+}
+
 }
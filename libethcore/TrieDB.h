@@ -40,6 +40,13 @@ struct TrieDBChannel: public LogChannel  { static const char* name() { return "-
 class InvalidTrie: public std::exception {};
 extern const h256 c_shaNull;
 
+/// @returns the root of the trie holding the pairs in @a _s, as GenericTrieDB would have it, but built directly
+/// rather than through a database. The nodes under each branch are hashed together with the multi-buffer sha3().
+h256 trieRoot(StringMap const& _s);
+
+/// @returns the root of the trie mapping rlp(i) to @a _data[i], as a block's transaction manifest does.
+h256 orderedTrieRoot(std::vector<bytes> const& _data);
+
 /**
  * @brief Merkle Patricia Tree "Trie": a modifed base-16 Radix tree.
  * This version uses an database backend.
@@ -198,13 +205,15 @@ public:
 
 private:
 	RLPStream& streamNode(RLPStream& _s, bytes const& _b);
+	/// @returns the number of bytes streamNode() will append for @a _b.
+	static uint streamedSize(bytes const& _b) { return _b.size() < 32 ? _b.size() : 33; }
 
-	std::string atAux(RLP const& _here, NibbleSlice _key) const;
+	std::string atAux(RLPView const& _here, NibbleSlice _key) const;
 
-	void mergeAtAux(RLPStream& _out, RLP const& _replace, NibbleSlice _key, bytesConstRef _value);
+	bytes mergeAtAux(RLP const& _replace, NibbleSlice _key, bytesConstRef _value);
 	bytes mergeAt(RLP const& _replace, NibbleSlice _k, bytesConstRef _v, bool _inLine = false);
 
-	bool deleteAtAux(RLPStream& _out, RLP const& _replace, NibbleSlice _key);
+	bytes deleteAtAux(RLP const& _replace, NibbleSlice _key);
 	bytes deleteAt(RLP const& _replace, NibbleSlice _k);
 
 	// in: null (DEL)  -- OR --  [_k, V] (DEL)
@@ -471,10 +480,10 @@ template <class DB> void GenericTrieDB<DB>::insert(bytesConstRef _key, bytesCons
 
 template <class DB> std::string GenericTrieDB<DB>::at(bytesConstRef _key) const
 {
-	return atAux(RLP(node(m_root)), _key);
+	return atAux(RLPView(node(m_root)), _key);
 }
 
-template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, NibbleSlice _key) const
+template <class DB> std::string GenericTrieDB<DB>::atAux(RLPView const& _here, NibbleSlice _key) const
 {
 	if (_here.isEmpty() || _here.isNull())
 		// not found.
@@ -482,13 +491,13 @@ template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, Nibbl
 	assert(_here.isList() && (_here.itemCount() == 2 || _here.itemCount() == 17));
 	if (_here.itemCount() == 2)
 	{
-		auto k = keyOf(_here);
-		if (_key == k && isLeaf(_here))
+		auto k = keyOf(_here.rlp());
+		if (_key == k && isLeaf(_here.rlp()))
 			// reached leaf and it's us
 			return _here[1].toString();
-		else if (_key.contains(k) && !isLeaf(_here))
+		else if (_key.contains(k) && !isLeaf(_here.rlp()))
 			// not yet at leaf and it might yet be us. onwards...
-			return atAux(_here[1].isList() ? _here[1] : RLP(node(_here[1].toHash<h256>())), _key.mid(k.size()));
+			return atAux(_here[1].isList() ? RLPView(_here[1]) : RLPView(node(_here[1].toHash<h256>())), _key.mid(k.size()));
 		else
 			// not us.
 			return std::string();
@@ -501,7 +510,7 @@ template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, Nibbl
 		if (n.isEmpty())
 			return std::string();
 		else
-			return atAux(n.isList() ? n : RLP(node(n.toHash<h256>())), _key.mid(1));
+			return atAux(n.isList() ? RLPView(n) : RLPView(node(n.toHash<h256>())), _key.mid(1));
 	}
 }
 
@@ -534,9 +543,10 @@ template <class DB> bytes GenericTrieDB<DB>::mergeAt(RLP const& _orig, NibbleSli
 		{
 			if (!_inLine)
 				killNode(_orig);
-			RLPStream s(2);
+			bytes b = mergeAtAux(_orig[1], _k.mid(k.size()), _v);
+			RLPStream s(2, _orig[0].data().size() + streamedSize(b));
 			s.append(_orig[0]);
-			mergeAtAux(s, _orig[1], _k.mid(k.size()), _v);
+			streamNode(s, b);
 			return s.out();
 		}
 
@@ -563,18 +573,20 @@ template <class DB> bytes GenericTrieDB<DB>::mergeAt(RLP const& _orig, NibbleSli
 
 		// not exactly our node - delve to next level at the correct index.
 		byte n = _k[0];
-		RLPStream r(17);
+		RLPView orig(_orig);
+		bytes b = mergeAtAux(orig[n], _k.mid(1), _v);
+		RLPStream r(17, orig.rlp().payload().size() - orig[n].data().size() + streamedSize(b));
 		for (byte i = 0; i < 17; ++i)
 			if (i == n)
-				mergeAtAux(r, _orig[i], _k.mid(1), _v);
+				streamNode(r, b);
 			else
-				r.append(_orig[i]);
+				r.append(orig[i]);
 		return r.out();
 	}
 
 }
 
-template <class DB> void GenericTrieDB<DB>::mergeAtAux(RLPStream& _out, RLP const& _orig, NibbleSlice _k, bytesConstRef _v)
+template <class DB> bytes GenericTrieDB<DB>::mergeAtAux(RLP const& _orig, NibbleSlice _k, bytesConstRef _v)
 {
 #if ETH_PARANOIA
 	tdebug << "mergeAtAux " << _orig << _k << sha3(_orig.data()).abridged() << ((_orig.isData() && _orig.size() <= 32) ? _orig.toHash<h256>().abridged() : std::string());
@@ -591,8 +603,7 @@ template <class DB> void GenericTrieDB<DB>::mergeAtAux(RLPStream& _out, RLP cons
 		assert(!r.isNull());
 		isRemovable = true;
 	}
-	bytes b = mergeAt(r, _k, _v, !isRemovable);
-	streamNode(_out, b);
+	return mergeAt(r, _k, _v, !isRemovable);
 }
 
 template <class DB> void GenericTrieDB<DB>::remove(bytesConstRef _key)
@@ -649,10 +660,12 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 		// partial key is our key - move down.
 		if (_k.contains(k))
 		{
-			RLPStream s;
-			s.appendList(2) << _orig[0];
-			if (!deleteAtAux(s, _orig[1], _k.mid(k.size())))
+			bytes b = deleteAtAux(_orig[1], _k.mid(k.size()));
+			if (b.empty())
 				return bytes();
+			RLPStream s(2, _orig[0].data().size() + streamedSize(b));
+			s << _orig[0];
+			streamNode(s, b);
 			killNode(_orig);
 			RLP r(s.out());
 			if (isTwoItemNode(r[1]))
@@ -691,15 +704,17 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 		else
 		{
 			// not exactly our node - delve to next level at the correct index.
-			RLPStream r(17);
 			byte n = _k[0];
+			RLPView orig(_orig);
+			bytes b = deleteAtAux(orig[n], _k.mid(1));
+			if (b.empty())	// bomb out if the key didn't turn up.
+				return bytes();
+			RLPStream r(17, orig.rlp().payload().size() - orig[n].data().size() + streamedSize(b));
 			for (byte i = 0; i < 17; ++i)
 				if (i == n)
-					if (!deleteAtAux(r, _orig[i], _k.mid(1)))	// bomb out if the key didn't turn up.
-						return bytes();
-					else {}
+					streamNode(r, b);
 				else
-					r << _orig[i];
+					r << orig[i];
 
 			// Kill the node.
 			killNode(_orig);
@@ -720,24 +735,14 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 
 }
 
-template <class DB> bool GenericTrieDB<DB>::deleteAtAux(RLPStream& _out, RLP const& _orig, NibbleSlice _k)
+template <class DB> bytes GenericTrieDB<DB>::deleteAtAux(RLP const& _orig, NibbleSlice _k)
 {
 #if ETH_PARANOIA
 	tdebug << "deleteAtAux " << _orig << _k << sha3(_orig.data()).abridged() << ((_orig.isData() && _orig.size() <= 32) ? _orig.toHash<h256>().abridged() : std::string());
 #endif
 
-	bytes b = _orig.isEmpty() ? bytes() : deleteAt(_orig.isList() ? _orig : RLP(node(_orig.toHash<h256>())), _k);
-
-	if (!b.size())	// not found - no change.
-		return false;
-
-/*	if (_orig.isList())
-		killNode(_orig);
-	else
-		killNode(_orig.toHash<h256>());*/
-
-	streamNode(_out, b);
-	return true;
+	// An empty return means not found - no change.
+	return _orig.isEmpty() ? bytes() : deleteAt(_orig.isList() ? _orig : RLP(node(_orig.toHash<h256>())), _k);
 }
 
 template <class DB> bytes GenericTrieDB<DB>::place(RLP const& _orig, NibbleSlice _k, bytesConstRef _s)
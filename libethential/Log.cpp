@@ -23,6 +23,10 @@
 
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
 using namespace std;
 using namespace eth;
 
@@ -52,3 +56,151 @@ void eth::simpleDebugOut(std::string const& _s, char const*)
 
 std::function<void(std::string const&, char const*)> eth::g_logPost = simpleDebugOut;
 
+
+bool eth::isChannelVisible(std::type_info const* _channel, int _verbosity)
+{
+	auto it = g_logOverride.find(_channel);
+	return it != g_logOverride.end() ? it->second : _verbosity <= g_logVerbosity;
+}
+
+namespace
+{
+
+/// A thread's pool of log streams; one for each log message being formatted at once.
+struct LogStreams
+{
+	std::vector<std::unique_ptr<LogStream>> streams;
+	unsigned inUse = 0;
+};
+
+boost::thread_specific_ptr<LogStreams> t_logStreams;
+
+/**
+ * @brief Hands log messages over to a thread that passes them to g_logPost.
+ * The queue is an intrusive multiple-producer, single-consumer one: producers swing the head
+ * to their entry with an atomic exchange, then link it from the previous head; the consumer
+ * follows the links from the tail. Neither side ever blocks the other.
+ */
+class AsyncLogSink
+{
+public:
+	AsyncLogSink(): m_head(&m_stub), m_tail(&m_stub) {}
+	~AsyncLogSink() { stop(); if (m_tail != &m_stub) delete m_tail; }
+
+	bool isActive() const { return m_active; }
+
+	void start()
+	{
+		if (m_thread)
+			return;
+		m_active = true;
+		m_thread.reset(new std::thread([=]()
+		{
+			setThreadName("log");
+			for (unsigned idle = 0; m_active;)
+				if (drain())
+					idle = 0;
+				else
+					this_thread::sleep_for(chrono::milliseconds(min(++idle, 10u)));
+		}));
+	}
+
+	void stop()
+	{
+		if (!m_thread)
+			return;
+		m_active = false;
+		m_thread->join();
+		m_thread.reset();
+		drain();
+	}
+
+	void push(std::string const& _s, char const* _channel)
+	{
+		Entry* e = new Entry(_s, _channel);
+		Entry* prev = m_head.exchange(e, std::memory_order_acq_rel);
+		prev->next.store(e, std::memory_order_release);
+	}
+
+private:
+	struct Entry
+	{
+		Entry() {}
+		Entry(std::string const& _s, char const* _channel): text(_s), channel(_channel) {}
+		std::string text;
+		char const* channel = nullptr;
+		std::atomic<Entry*> next{nullptr};
+	};
+
+	/// Post everything that's been fully linked in. @returns true if there was anything.
+	bool drain()
+	{
+		bool ret = false;
+		while (Entry* e = m_tail->next.load(std::memory_order_acquire))
+		{
+			g_logPost(e->text, e->channel);
+			// The entry just posted becomes the new tail; the old one can go.
+			if (m_tail != &m_stub)
+				delete m_tail;
+			m_tail = e;
+			ret = true;
+		}
+		return ret;
+	}
+
+	Entry m_stub;
+	std::atomic<Entry*> m_head;			///< Most recently pushed entry; touched by producers.
+	Entry* m_tail;						///< Most recently posted entry (or the stub); touched only by the consumer.
+	std::atomic<bool> m_active{false};
+	std::unique_ptr<std::thread> m_thread;
+};
+
+AsyncLogSink& asyncLogSink()
+{
+	static AsyncLogSink s_sink;
+	return s_sink;
+}
+
+}
+
+LogStream& eth::acquireLogStream()
+{
+	if (!t_logStreams.get())
+		t_logStreams.reset(new LogStreams);
+	LogStreams& p = *t_logStreams;
+	if (p.inUse == p.streams.size())
+		p.streams.emplace_back(new LogStream);
+	LogStream& ret = *p.streams[p.inUse++];
+
+	// Forget the last message and any formatting it left behind, but keep the buffer's capacity.
+	ret.str().clear();
+	ret.clear();
+	ret.flags(ios_base::dec | ios_base::skipws);
+	ret.width(0);
+	ret.precision(6);
+	ret.fill(' ');
+	return ret;
+}
+
+void eth::releaseLogStream()
+{
+	t_logStreams->inUse--;
+}
+
+void eth::postLog(std::string const& _s, char const* _channel)
+{
+	if (asyncLogSink().isActive())
+		asyncLogSink().push(_s, _channel);
+	else
+		g_logPost(_s, _channel);
+}
+
+void eth::startAsyncLogging()
+{
+	asyncLogSink().start();
+}
+
+void eth::stopAsyncLogging()
+{
+	asyncLogSink().stop();
+}
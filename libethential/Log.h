@@ -25,6 +25,10 @@
 
 #include <ctime>
 #include <chrono>
+#include <string>
+#include <ostream>
+#include <functional>
+#include <map>
 #include <boost/thread.hpp>
 #include "vector_ref.h"
 
@@ -47,11 +51,60 @@ extern int g_logVerbosity;
 /// The current method that the logging system uses to output the log messages. Defaults to simpleDebugOut().
 extern std::function<void(std::string const&, char const*)> g_logPost;
 
+/// Hand the log messages to g_logPost from a background thread rather than from the thread that logged them.
+/// Messages are passed over through a lock-free queue, so logging threads pay only for formatting.
+void startAsyncLogging();
+
+/// Pass on anything still queued and go back to calling g_logPost from the logging thread.
+/// Call once other threads have stopped logging.
+void stopAsyncLogging();
+
+/// Pass a finished log message on to g_logPost, either directly or through the asynchronous queue.
+void postLog(std::string const& _s, char const* _channel);
+
 /// Map of Log Channel types to bool, false forces the channel to be disabled, true forces it to be enabled.
 /// If a channel has no entry, then it will output as long as its verbosity (LogChannel::verbosity) is less than
 /// or equal to the currently output verbosity (g_logVerbosity).
 extern std::map<std::type_info const*, bool> g_logOverride;
 
+/// @returns true if a channel with the given type and verbosity should output, according to g_logOverride and g_logVerbosity.
+bool isChannelVisible(std::type_info const* _channel, int _verbosity);
+
+/// @returns true if the channel Id should output. Just a comparison unless there are overrides.
+template <class Id> bool isChannelVisible() { return g_logOverride.empty() ? Id::verbosity <= g_logVerbosity : isChannelVisible(&typeid(Id), Id::verbosity); }
+
+/// Stream buffer that appends to a string, which keeps its capacity from one log message to the next.
+class LogStreamBuf: public std::streambuf
+{
+public:
+	std::string& str() { return m_s; }
+
+protected:
+	virtual int_type overflow(int_type _c) { if (_c != traits_type::eof()) m_s.push_back((char)_c); return _c; }
+	virtual std::streamsize xsputn(char const* _s, std::streamsize _n) { m_s.append(_s, (size_t)_n); return _n; }
+
+private:
+	std::string m_s;
+};
+
+/// Formatting stream for a log message.
+class LogStream: public std::ostream
+{
+public:
+	LogStream(): std::ostream(&m_buf) {}
+	std::string& str() { return m_buf.str(); }
+
+private:
+	LogStreamBuf m_buf;
+};
+
+/// Take a cleared LogStream from the current thread's pool. Messages formatted while another is being formatted
+/// (e.g. by an operator<< that itself logs) get a stream of their own.
+LogStream& acquireLogStream();
+
+/// Give the stream most recently taken with acquireLogStream() back to the current thread's pool.
+void releaseLogStream();
+
 /// Associate a name with each thread for nice logging.
 struct ThreadLocalLogName
 {
@@ -75,6 +128,7 @@ struct NoteChannel: public LogChannel  { static const char* name() { return "***
 struct DebugChannel: public LogChannel { static const char* name() { return "---"; } static const int verbosity = 0; };
 
 /// Logging class, iostream-like, that can be shifted to.
+/// Does nothing at all if the channel isn't visible; the log macros avoid even constructing it in that case.
 template <class Id, bool _AutoSpacing = true>
 class LogOutputStream
 {
@@ -83,32 +137,44 @@ public:
 	/// If _term is true the the prefix info is terminated with a ']' character; if not it ends only with a '|' character.
 	LogOutputStream(bool _term = true)
 	{
-		std::type_info const* i = &typeid(Id);
-		auto it = g_logOverride.find(i);
-		if ((it != g_logOverride.end() && it->second == true) || (it == g_logOverride.end() && Id::verbosity <= g_logVerbosity))
+		if (isChannelVisible<Id>())
 		{
+			m_sstr = &acquireLogStream();
 			time_t rawTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 			char buf[24];
 			if (strftime(buf, 24, "%X", localtime(&rawTime)) == 0)
 				buf[0] = '\0'; // empty if case strftime fails
-			m_sstr << Id::name() << " [ " << buf << " | " << (t_logThreadName.m_name.get() ? *t_logThreadName.m_name.get() : std::string("<unknown>")) << (_term ? " ] " : "");
+			*m_sstr << Id::name() << " [ " << buf << " | " << (t_logThreadName.m_name.get() ? *t_logThreadName.m_name.get() : std::string("<unknown>")) << (_term ? " ] " : "");
 		}
 	}
+	LogOutputStream(LogOutputStream const&) = delete;
 
 	/// Destructor. Posts the accrued log entry to the g_logPost function.
-	~LogOutputStream() { if (Id::verbosity <= g_logVerbosity) g_logPost(m_sstr.str(), Id::name()); }
+	~LogOutputStream() { if (m_sstr) { postLog(m_sstr->str(), Id::name()); releaseLogStream(); } }
 
 	/// Shift arbitrary data to the log. Spaces will be added between items as required.
-	template <class T> LogOutputStream& operator<<(T const& _t) { if (Id::verbosity <= g_logVerbosity) { if (_AutoSpacing && m_sstr.str().size() && m_sstr.str().back() != ' ') m_sstr << " "; m_sstr << _t; } return *this; }
+	template <class T> LogOutputStream& operator<<(T const& _t) { if (m_sstr) { if (_AutoSpacing && m_sstr->str().size() && m_sstr->str().back() != ' ') *m_sstr << " "; *m_sstr << _t; } return *this; }
 
 private:
-	std::stringstream m_sstr;	///< The accrued log entry.
+	LogStream* m_sstr = nullptr;	///< The accrued log entry; null if the channel isn't visible.
 };
 
+/// Log channels more verbose than this are compiled out altogether.
+#ifndef ETH_LOG_MAX_VERBOSITY
+#define ETH_LOG_MAX_VERBOSITY 100
+#endif
+
+/// Swallows a log statement's stream so that both arms of ETH_LOG_GUARD's conditional are void.
+struct LogVoidify { template <class T> void operator&(T const&) {} };
+
+/// Prefix to a log statement such that, unless channel X is visible, nothing of the statement is evaluated.
+/// '&' binds more loosely than '<<', so the whole statement ends up on the right of it.
+#define ETH_LOG_GUARD(X) (X::verbosity > ETH_LOG_MAX_VERBOSITY || !eth::isChannelVisible<X>()) ? (void)0 : eth::LogVoidify() &
+
 // Simple cout-like stream objects for accessing common log channels.
 // Dirties the global namespace, but oh so convenient...
-#define cnote eth::LogOutputStream<eth::NoteChannel, true>()
-#define cwarn eth::LogOutputStream<eth::WarnChannel, true>()
+#define cnote ETH_LOG_GUARD(eth::NoteChannel) eth::LogOutputStream<eth::NoteChannel, true>()
+#define cwarn ETH_LOG_GUARD(eth::WarnChannel) eth::LogOutputStream<eth::WarnChannel, true>()
 
 // Null stream-like objects.
 #define ndebug if (true) {} else eth::NullOutputStream()
@@ -119,7 +185,7 @@ private:
 #if NDEBUG
 #define cdebug ndebug
 #else
-#define cdebug eth::LogOutputStream<eth::DebugChannel, true>()
+#define cdebug ETH_LOG_GUARD(eth::DebugChannel) eth::LogOutputStream<eth::DebugChannel, true>()
 #endif
 
 // Kill all logs when when NLOG is defined.
@@ -127,8 +193,8 @@ private:
 #define clog(X) nlog(X)
 #define cslog(X) nslog(X)
 #else
-#define clog(X) eth::LogOutputStream<X, true>()
-#define cslog(X) eth::LogOutputStream<X, false>()
+#define clog(X) ETH_LOG_GUARD(X) eth::LogOutputStream<X, true>()
+#define cslog(X) ETH_LOG_GUARD(X) eth::LogOutputStream<X, false>()
 #endif
 
 }
@@ -160,6 +160,81 @@ eth::uint RLP::items() const
 	return 0;
 }
 
+namespace
+{
+
+/// Nesting deeper than this is certainly an attack; stop before the stack gives out.
+static const unsigned c_maxRLPDepth = 256;
+
+/// Checks the item at the start of @a _d is well-formed and canonical, throwing BadRLP if not.
+/// @returns the item's size.
+eth::uint validateItem(bytesConstRef _d, unsigned _depth)
+{
+	if (_d.empty() || _depth > c_maxRLPDepth)
+		throw BadRLP();
+	byte n = _d[0];
+	if (n < c_rlpDataImmLenStart)
+		return 1;
+
+	bool list = n >= c_rlpListStart;
+	byte base = list ? c_rlpListStart : c_rlpDataImmLenStart;
+	byte immCount = list ? c_rlpListImmLenCount : c_rlpDataImmLenCount;
+	eth::uint header = 1;
+	eth::uint length = n - base;
+	if (length >= immCount)
+	{
+		header += length - immCount + 1;
+		// Length of length must be there and have no leading zero; the length must need the long form.
+		if (_d.size() < header || !_d[1])
+			throw BadRLP();
+		length = 0;
+		for (unsigned i = 1; i < header; ++i)
+			length = (length << 8) | _d[i];
+		if (length < immCount)
+			throw BadRLP();
+	}
+	if (length > _d.size() - header)
+		throw BadRLP();
+
+	if (!list && length == 1 && _d[1] < c_rlpDataImmLenStart)
+		// Should have been encoded as the byte itself.
+		throw BadRLP();
+	if (list)
+		for (bytesConstRef p = _d.cropped(header, length); p.size(); p = p.cropped(validateItem(p, _depth + 1))) {}
+	return header + length;
+}
+
+}
+
+RLPView::RLPView(bytesConstRef _d)
+{
+	if (_d.empty())
+		return;
+	m_rlp = RLP(_d.cropped(0, validateItem(_d, 0)));
+	if (!m_rlp.isList())
+		return;
+
+	auto note = [&](unsigned o)
+	{
+		if (m_count < c_inlineItems + 1)
+			m_inline[m_count] = o;
+		else
+		{
+			if (m_count == c_inlineItems + 1)
+				m_spilled.assign(m_inline.begin(), m_inline.end());
+			m_spilled.push_back(o);
+		}
+	};
+	bytesConstRef d = m_rlp.data();
+	unsigned o = m_rlp.payload().data() - d.data();
+	for (; o < d.size(); ++m_count)
+	{
+		note(o);
+		o += RLP(d.cropped(o)).actualSize();
+	}
+	note(o);
+}
+
 RLPStream& RLPStream::appendRaw(bytesConstRef _s, uint _itemCount)
 {
 	uint os = m_out.size();
@@ -176,13 +251,19 @@ void RLPStream::noteAppended(uint _itemCount)
 //	cdebug << "noteAppended(" << _itemCount << ")";
 	while (m_listStack.size())
 	{
-		assert(m_listStack.back().first >= _itemCount);
-		m_listStack.back().first -= _itemCount;
-		if (m_listStack.back().first)
+		assert(m_listStack.back().items >= _itemCount);
+		m_listStack.back().items -= _itemCount;
+		if (m_listStack.back().items)
 			break;
+		else if (m_listStack.back().end)
+		{
+			// Header went out up front; just check the caller's sums were right.
+			assert(m_out.size() == m_listStack.back().end);
+			m_listStack.pop_back();
+		}
 		else
 		{
-			auto p = m_listStack.back().second;
+			auto p = m_listStack.back().begin;
 			m_listStack.pop_back();
 			uint s = m_out.size() - p;		// list size
 			auto brs = bytesRequired(s);
@@ -209,12 +290,25 @@ RLPStream& RLPStream::appendList(uint _items)
 {
 //	cdebug << "appendList(" << _items << ")";
 	if (_items)
-		m_listStack.push_back(std::make_pair(_items, m_out.size()));
+		m_listStack.push_back(ListFrame{_items, (uint)m_out.size(), 0});
 	else
 		appendList(bytes());
 	return *this;
 }
 
+RLPStream& RLPStream::appendList(uint _items, uint _payloadSize)
+{
+	if (!_items)
+		return appendList(bytes());
+	reserve(rlpListSize(_payloadSize));
+	if (_payloadSize < c_rlpListImmLenCount)
+		m_out.push_back((byte)(c_rlpListStart + _payloadSize));
+	else
+		pushCount(_payloadSize, c_rlpListIndLenZero);
+	m_listStack.push_back(ListFrame{_items, (uint)m_out.size(), (uint)m_out.size() + _payloadSize});
+	return *this;
+}
+
 RLPStream& RLPStream::appendList(bytesConstRef _rlp)
 {
 	if (_rlp.size() < c_rlpListImmLenCount)
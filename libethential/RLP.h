@@ -261,8 +261,87 @@ private:
 	mutable bytesConstRef m_lastItem;
 };
 
+/**
+ * @brief A checked, indexed view of an RLP item.
+ *
+ * Construction validates the whole item once: every length must fit inside its parent and be
+ * canonically encoded, and every list's items must exactly fill it; BadRLP is thrown otherwise.
+ * The top-level items' offsets are then tabled, so operator[] and itemCount() are O(1) and items
+ * it hands out may be read without further bounds checks. Anything after the first item in the
+ * data given is ignored.
+ */
+class RLPView
+{
+public:
+	/// Construct a null view.
+	RLPView() {}
+
+	/// Validate and index the RLP item at the start of @a _d. Empty data gives a null view.
+	explicit RLPView(bytesConstRef _d);
+	explicit RLPView(bytes const& _d): RLPView(&_d) {}
+	explicit RLPView(std::string const& _s): RLPView(bytesConstRef(_s)) {}
+	explicit RLPView(RLP const& _r): RLPView(_r.data()) {}
+
+	/// The item itself.
+	RLP const& rlp() const { return m_rlp; }
+	bytesConstRef data() const { return m_rlp.data(); }
+
+	bool isNull() const { return m_rlp.isNull(); }
+	bool isEmpty() const { return m_rlp.isEmpty(); }
+	bool isData() const { return m_rlp.isData(); }
+	bool isList() const { return m_rlp.isList(); }
+
+	/// @returns the number of items in the list, or zero if it isn't a list.
+	uint itemCount() const { return m_count; }
+
+	/// @returns the list item @a _i, or RLP() if there's no such item.
+	RLP operator[](uint _i) const { return _i < m_count ? RLP(m_rlp.data().cropped(offset(_i), offset(_i + 1) - offset(_i))) : RLP(); }
+
+private:
+	/// Enough for a trie branch node; anything longer spills to the heap.
+	static const unsigned c_inlineItems = 17;
+
+	unsigned offset(uint _i) const { return m_count > c_inlineItems ? m_spilled[_i] : m_inline[_i]; }
+
+	RLP m_rlp;
+	uint m_count = 0;
+	std::array<unsigned, c_inlineItems + 1> m_inline;	///< Item offsets and then the end, while there are few enough items.
+	std::vector<unsigned> m_spilled;					///< Item offsets and then the end, otherwise.
+};
+
+/// @returns the number of bytes of header an RLP item with a payload of @a _payload bytes needs.
+/// Doesn't account for single bytes below 0x80, which are their own encoding.
+inline uint rlpHeaderSize(uint _payload, bool _isList = false) { return _payload < (_isList ? c_rlpListImmLenCount : c_rlpDataImmLenCount) ? 1 : 1 + bytesRequired(_payload); }
+
+/// @returns the number of bytes RLPStream::append() will write for the given datum.
+inline uint rlpSize(bytesConstRef _s) { return _s.size() == 1 && _s[0] < c_rlpDataImmLenStart ? 1 : rlpHeaderSize(_s.size()) + _s.size(); }
+inline uint rlpSize(bytes const& _s) { return rlpSize(bytesConstRef(&_s)); }
+inline uint rlpSize(std::string const& _s) { return rlpSize(bytesConstRef(_s)); }
+template <class _T> inline uint rlpIntSize(_T _i) { return _i < c_rlpDataImmLenStart ? 1 : 1 + bytesRequired(_i); }
+inline uint rlpSize(uint _i) { return rlpIntSize(_i); }
+inline uint rlpSize(u160 _i) { return rlpIntSize(_i); }
+inline uint rlpSize(u256 _i) { return rlpIntSize(_i); }
+inline uint rlpSize(bigint _i) { return _i < c_rlpDataImmLenStart ? 1 : rlpHeaderSize(bytesRequired(_i)) + bytesRequired(_i); }
+template <unsigned N> inline uint rlpSize(FixedHash<N> const& _s, bool _compact = false, bool _allOrNothing = false)
+{
+	if (_allOrNothing && !_s)
+		return 1;
+	bytesConstRef r = _s.ref();
+	while (_compact && r.size() && !r[0])
+		r = r.cropped(1);
+	return rlpSize(r);
+}
+
+/// @returns the number of bytes a list whose items take @a _payload bytes in total encodes to.
+inline uint rlpListSize(uint _payload) { return rlpHeaderSize(_payload, true) + _payload; }
+
 /**
  * @brief Class for writing to an RLP bytestream.
+ *
+ * Lists whose item count is given alone have their header back-patched once the last item is in,
+ * which means moving everything written since. Where the caller can say how many bytes the items
+ * will take (see rlpSize()), use the sized forms of appendList() and the constructor instead: the
+ * header goes straight out and the output grows at most once for the whole list.
  */
 class RLPStream
 {
@@ -273,12 +352,19 @@ public:
 	/// Initializes the RLPStream as a list of @a _listItems items.
 	explicit RLPStream(uint _listItems) { appendList(_listItems); }
 
+	/// Initializes the RLPStream as a list of @a _listItems items taking @a _payloadSize bytes in total.
+	RLPStream(uint _listItems, uint _payloadSize) { appendList(_listItems, _payloadSize); }
+
+	/// Initializes empty RLPStream that writes into @a _buffer's storage, so a caller can reuse one
+	/// allocation across many encodings. Get it back with swapOut().
+	explicit RLPStream(bytes&& _buffer): m_out(std::move(_buffer)) { m_out.clear(); }
+
 	~RLPStream() {}
 
 	/// Append given datum to the byte stream.
-	RLPStream& append(uint _s) { return append(bigint(_s)); }
-	RLPStream& append(u160 _s) { return append(bigint(_s)); }
-	RLPStream& append(u256 _s) { return append(bigint(_s)); }
+	RLPStream& append(uint _s) { return appendInt(_s); }
+	RLPStream& append(u160 _s) { return appendInt(_s); }
+	RLPStream& append(u256 _s) { return appendInt(_s); }
 	RLPStream& append(bigint _s);
 	RLPStream& append(bytesConstRef _s, bool _compact = false);
 	RLPStream& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
@@ -298,6 +384,8 @@ public:
 
 	/// Appends a list.
 	RLPStream& appendList(uint _items);
+	/// Appends a list of @a _items items which will take exactly @a _payloadSize bytes between them.
+	RLPStream& appendList(uint _items, uint _payloadSize);
 	RLPStream& appendList(bytesConstRef _rlp);
 	RLPStream& appendList(bytes const& _rlp) { return appendList(&_rlp); }
 	RLPStream& appendList(RLPStream const& _s) { return appendList(&_s.out()); }
@@ -312,6 +400,9 @@ public:
 	/// Clear the output stream so far.
 	void clear() { m_out.clear(); m_listStack.clear(); }
 
+	/// Make sure there's room for another @a _size bytes without the output being reallocated.
+	void reserve(uint _size) { if (m_out.capacity() < m_out.size() + _size) m_out.reserve(std::max<uint>(m_out.size() + _size, m_out.capacity() * 2)); }
+
 	/// Read the byte stream.
 	bytes const& out() const { assert(m_listStack.empty()); return m_out; }
 
@@ -319,6 +410,23 @@ public:
 	void swapOut(bytes& _dest) { assert(m_listStack.empty()); swap(m_out, _dest); }
 
 private:
+	/// Append an integer of at most 32 bytes without going through bigint.
+	template <class _T> RLPStream& appendInt(_T _i)
+	{
+		if (!_i)
+			m_out.push_back(c_rlpDataImmLenStart);
+		else if (_i < c_rlpDataImmLenStart)
+			m_out.push_back((byte)_i);
+		else
+		{
+			uint br = bytesRequired(_i);
+			m_out.push_back((byte)(br + c_rlpDataImmLenStart));
+			pushInt(_i, br);
+		}
+		noteAppended();
+		return *this;
+	}
+
 	void noteAppended(uint _itemCount = 1);
 
 	/// Push the node-type byte (using @a _base) along with the item count @a _count.
@@ -337,7 +445,13 @@ private:
 	/// Our output byte stream.
 	bytes m_out;
 
-	std::vector<std::pair<uint, uint>> m_listStack;
+	struct ListFrame
+	{
+		uint items;			///< Items still to come.
+		uint begin;			///< Where the payload starts in m_out.
+		uint end;			///< Where the payload must end in m_out if the header's already written, otherwise 0.
+	};
+	std::vector<ListFrame> m_listStack;
 };
 
 template <class _T> void rlpListAux(RLPStream& _out, _T _t) { _out << _t; }
@@ -22,6 +22,7 @@
 #include "BlockChain.h"
 
 #include <boost/filesystem.hpp>
+#include <leveldb/write_batch.h>
 #include <libethential/Common.h>
 #include <libethential/RLP.h>
 #include <libethcore/FileSystem.h>
@@ -85,6 +86,40 @@ ldb::Slice eth::toSlice(h256 _h, unsigned _sub)
 #endif
 }
 
+namespace
+{
+
+/// Index keys. 'n' and the big-endian block number maps to the canonical block's hash; 'a', the address, the
+/// big-endian block number and the block's hash maps to the list of the block's transactions involving the address.
+/// Keeping the number big-endian means an address's blocks are contiguous and in order.
+string numberKey(eth::uint _n)
+{
+	string ret(9, 'n');
+	for (unsigned i = 0; i < 8; ++i)
+		ret[8 - i] = (char)(byte)(_n >> (i * 8));
+	return ret;
+}
+
+string addressPrefix(Address const& _a)
+{
+	return "a" + string((char const*)_a.data(), Address::size);
+}
+
+string addressKey(Address const& _a, eth::uint _n, h256 const& _h)
+{
+	return addressPrefix(_a) + numberKey(_n).substr(1) + string((char const*)_h.data(), h256::size);
+}
+
+void noteInvolved(Manifest const& _m, unsigned _i, map<Address, set<unsigned>>& o_involved)
+{
+	o_involved[_m.from].insert(_i);
+	o_involved[_m.to].insert(_i);
+	for (auto const& m: _m.internal)
+		noteInvolved(m, _i, o_involved);
+}
+
+}
+
 bytes BlockChain::createGenesisBlock()
 {
 	RLPStream block(3);
@@ -115,6 +150,7 @@ BlockChain::BlockChain(std::string _path, bool _killExisting)
 	{
 		boost::filesystem::remove_all(_path + "/blocks");
 		boost::filesystem::remove_all(_path + "/details");
+		boost::filesystem::remove_all(_path + "/index");
 	}
 
 	ldb::Options o;
@@ -123,6 +159,8 @@ BlockChain::BlockChain(std::string _path, bool _killExisting)
 	assert(m_db);
 	s = ldb::DB::Open(o, _path + "/details", &m_extrasDB);
 	assert(m_extrasDB);
+	s = ldb::DB::Open(o, _path + "/index", &m_indexDB);
+	assert(m_indexDB);
 
 	// Initialise with the genesis as the last block on the longest chain.
 	m_genesisHash = BlockChain::genesis().hash;
@@ -144,12 +182,16 @@ BlockChain::BlockChain(std::string _path, bool _killExisting)
 
 	m_lastBlockHash = l.empty() ? m_genesisHash : *(h256*)l.data();
 
+	// Catches up a DB from before the index existed, or one we didn't get to finish indexing.
+	updateIndex(m_lastBlockHash);
+
 	cnote << "Opened blockchain DB. Latest: " << currentHash();
 }
 
 BlockChain::~BlockChain()
 {
 	cnote << "Closing blockchain DB";
+	delete m_indexDB;
 	delete m_extrasDB;
 	delete m_db;
 }
@@ -257,7 +299,7 @@ h256s BlockChain::import(bytes const& _block, OverlayDB const& _db)
 		// Check transactions are valid and that they result in a state equivalent to our state_root.
 		// Get total difficulty increase and update state, checking it.
 		State s(bi.coinbaseAddress, _db);
-		auto tdIncrease = s.enactOn(&_block, bi, *this);
+		auto tdIncrease = s.enactOn(&_block, bi, *this, m_importThreads);
 		auto b = s.bloom();
 		BlockBlooms bb;
 		BlockTraces bt;
@@ -318,6 +360,7 @@ h256s BlockChain::import(bytes const& _block, OverlayDB const& _db)
 			m_lastBlockHash = newHash;
 		}
 		m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)&newHash, 32));
+		updateIndex(newHash);
 		clog(BlockChainNote) << "   Imported and best. Has" << (details(bi.parentHash).children.size() - 1) << "siblings. Route:";
 		for (auto r: ret)
 			clog(BlockChainNote) << r;
@@ -415,7 +458,69 @@ h256 BlockChain::numberHash(unsigned _n) const
 {
 	if (!_n)
 		return genesisHash();
+	if (h256 ret = indexedHash(_n))
+		return ret;
 	h256 ret = currentHash();
 	for (; _n < details().number; ++_n, ret = details(ret).parent) {}
 	return ret;
 }
+
+h256 BlockChain::indexedHash(uint _n) const
+{
+	string s;
+	m_indexDB->Get(m_readOptions, ldb::Slice(numberKey(_n)), &s);
+	return s.size() == h256::size ? h256((byte const*)s.data(), h256::ConstructFromPointer) : h256();
+}
+
+void BlockChain::updateIndex(h256 _best)
+{
+	// Walk back from the new best block until we meet the chain the index already knows about, indexing each block
+	// on the way. Entries of blocks that are no longer canonical are left be; the number index tells them apart.
+	ldb::WriteBatch batch;
+	uint top = details(_best).number;
+	unsigned indexed = 0;
+	h256 h = _best;
+	for (uint n = top; n && indexedHash(n) != h; --n, h = details(h).parent, ++indexed)
+	{
+		map<Address, set<unsigned>> involved;
+		auto ms = traces(h).traces;
+		for (unsigned i = 0; i < ms.size(); ++i)
+			noteInvolved(ms[i], i, involved);
+		for (auto const& i: involved)
+		{
+			RLPStream s;
+			s << i.second;
+			batch.Put(ldb::Slice(addressKey(i.first, n, h)), (ldb::Slice)ref(s.out()));
+		}
+		batch.Put(ldb::Slice(numberKey(n)), ldb::Slice((char const*)h.data(), h256::size));
+	}
+
+	// The new chain may be shorter than the old.
+	for (uint n = top + 1; indexedHash(n); ++n)
+		batch.Delete(ldb::Slice(numberKey(n)));
+
+	m_indexDB->Write(m_writeOptions, &batch);
+	if (indexed > 1)
+		clog(BlockChainNote) << "Indexed" << indexed << "blocks.";
+}
+
+void BlockChain::involving(Address const& _a, uint _earliest, uint _latest, map<uint, set<unsigned>>& o_found) const
+{
+	string prefix = addressPrefix(_a);
+	string first = prefix + numberKey(_earliest).substr(1);
+	unique_ptr<ldb::Iterator> it(m_indexDB->NewIterator(m_readOptions));
+	for (it->Seek(ldb::Slice(first)); it->Valid() && it->key().starts_with(ldb::Slice(prefix)); it->Next())
+	{
+		bytesConstRef k((byte const*)it->key().data(), it->key().size());
+		uint n = 0;
+		for (unsigned i = 0; i < 8; ++i)
+			n = (n << 8) | k[prefix.size() + i];
+		if (n > _latest)
+			break;
+		// Skip blocks that have since been reorganised out of the canonical chain.
+		if (indexedHash(n) != h256(k.data() + prefix.size() + 8, h256::ConstructFromPointer))
+			continue;
+		for (auto const& i: RLP(bytesConstRef((byte const*)it->value().data(), it->value().size())))
+			o_found[n].insert(i.toInt<unsigned>());
+	}
+}
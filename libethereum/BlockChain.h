@@ -22,6 +22,7 @@
 #pragma once
 
 #include <mutex>
+#include <atomic>
 #include <libethential/Log.h>
 #include <libethcore/CommonEth.h>
 #include <libethcore/BlockInfo.h>
@@ -78,6 +79,10 @@ public:
 	/// @returns the block hashes of any blocks that came into/went out of the canonical block chain.
 	h256s import(bytes const& _block, OverlayDB const& _stateDB);
 
+	/// Set the number of threads to execute an imported block's transactions on. 1, the default, executes them serially.
+	void setImportThreads(unsigned _threads) { m_importThreads = std::max(1u, _threads); }
+	unsigned importThreads() const { return m_importThreads; }
+
 	/// Get the familial details concerning a block (or the most recent mined if none given). Thread-safe.
 	BlockDetails details(h256 _hash) const { return queryExtras<BlockDetails, 0>(_hash, m_details, x_details, NullBlockDetails); }
 	BlockDetails details() const { return details(currentHash()); }
@@ -104,9 +109,13 @@ public:
 	/// Get the hash of the genesis block. Thread-safe.
 	h256 genesisHash() const { return m_genesisHash; }
 
-	/// Get the hash of a block of a given number. Slow; try not to use it too much.
+	/// Get the hash of a block of a given number on the canonical chain. Thread-safe.
 	h256 numberHash(unsigned _n) const;
 
+	/// Add to @a o_found the transactions of each canonical block numbered @a _earliest to @a _latest inclusive in which
+	/// @a _a sent or received a message, at any depth, keyed by block number. Thread-safe.
+	void involving(Address const& _a, uint _earliest, uint _latest, std::map<uint, std::set<unsigned>>& o_found) const;
+
 	/// @returns the genesis block header.
 	static BlockInfo const& genesis() { UpgradableGuard l(x_genesis); if (!s_genesis) { auto gb = createGenesisBlock(); UpgradeGuard ul(l); (s_genesis = new BlockInfo)->populate(&gb); } return *s_genesis; }
 
@@ -155,6 +164,12 @@ private:
 
 	void checkConsistency();
 
+	/// Bring the index into line with a canonical chain ending at @a _best.
+	void updateIndex(h256 _best);
+
+	/// @returns the canonical block of number @a _n according to the index, or h256() if it has none.
+	h256 indexedHash(uint _n) const;
+
 	/// The caches of the disk DB and their locks.
 	mutable boost::shared_mutex x_details;
 	mutable BlockDetailsHash m_details;
@@ -168,6 +183,7 @@ private:
 	/// The disk DBs. Thread-safe, so no need for locks.
 	ldb::DB* m_db;
 	ldb::DB* m_extrasDB;
+	ldb::DB* m_indexDB;		///< Canonical block number -> hash, and address -> blocks & transactions it's involved in.
 
 	/// Hash of the last (valid) block on the longest chain.
 	mutable boost::shared_mutex x_lastBlockHash;
@@ -177,6 +193,8 @@ private:
 	h256 m_genesisHash;
 	bytes m_genesisBlock;
 
+	std::atomic<unsigned> m_importThreads = {1};	///< Threads to execute imported blocks' transactions on.
+
 	ldb::ReadOptions m_readOptions;
 	ldb::WriteOptions m_writeOptions;
 
@@ -28,7 +28,7 @@
 using namespace std;
 using namespace eth;
 
-bool BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
+BlockImportResult BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 {
 	// Check if we already know this block.
 	h256 h = sha3(_block);
@@ -37,7 +37,7 @@ bool BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 
 	if (m_readySet.count(h) || m_drainingSet.count(h) || m_futureSet.count(h))
 		// Already know about this one.
-		return false;
+		return BlockImportResult::AlreadyKnown;
 
 	// VERIFY: populates from the block and checks the block is internally coherent.
 	BlockInfo bi;
@@ -53,18 +53,18 @@ bool BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 	catch (Exception const& _e)
 	{
 		cwarn << "Ignoring malformed block: " << _e.description();
-		return false;
+		return BlockImportResult::Malformed;
 	}
 #endif
 	auto newHash = eth::sha3(_block);
 
 	// Check block doesn't already exist first!
 	if (_bc.details(newHash))
-		return false;
+		return BlockImportResult::AlreadyKnown;
 
 	// Check it's not crazy
 	if (bi.timestamp > (u256)time(0))
-		return false;
+		return BlockImportResult::FutureTime;
 
 	{
 		UpgradeGuard ul(l);
@@ -86,7 +86,7 @@ bool BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 		}
 	}
 
-	return true;
+	return BlockImportResult::Success;
 }
 
 void BlockQueue::noteReadyWithoutWriteGuard(h256 _good)
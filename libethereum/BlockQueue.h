@@ -31,6 +31,15 @@ namespace eth
 
 class BlockChain;
 
+/// What became of a block given to BlockQueue::import().
+enum class BlockImportResult
+{
+	Success,		///< It's queued, either ready for the chain or waiting on its parent.
+	AlreadyKnown,	///< It's queued or in the chain already.
+	Malformed,		///< It isn't internally coherent.
+	FutureTime		///< Its timestamp is ahead of our clock; maybe just skew, so we ignore it for now.
+};
+
 /**
  * @brief A queue of blocks. Sits between network or other I/O and the BlockChain.
  * Sorts them ready for blockchain insertion (with the BlockChain::sync() method).
@@ -40,7 +49,7 @@ class BlockQueue
 {
 public:
 	/// Import a block into the queue.
-	bool import(bytesConstRef _tx, BlockChain const& _bc);
+	BlockImportResult import(bytesConstRef _tx, BlockChain const& _bc);
 
 	/// Grabs the blocks that are ready, giving them in the correct order for insertion into the chain.
 	/// Don't forget to call doneDrain() once you're done importing.
@@ -52,6 +61,9 @@ public:
 	/// Notify the queue that the chain has changed and a new block has attained 'ready' status (i.e. is in the chain).
 	void noteReady(h256 _b) { WriteGuard l(m_lock); noteReadyWithoutWriteGuard(_b); }
 
+	/// @returns true if the block of hash @a _h is already queued.
+	bool knows(h256 _h) const { ReadGuard l(m_lock); return m_readySet.count(_h) || m_drainingSet.count(_h) || m_futureSet.count(_h); }
+
 	/// Get information on the items queued.
 	std::pair<unsigned, unsigned> items() const { ReadGuard l(m_lock); return std::make_pair(m_ready.size(), m_future.size()); }
 
@@ -30,6 +30,9 @@
 using namespace std;
 using namespace eth;
 
+/// How long after an external miner last asked for work we keep preparing blocks for it.
+static const chrono::seconds c_remoteMiningTimeout(10);
+
 void MessageFilter::fillStream(RLPStream& _s) const
 {
 	_s.appendList(8) << m_from << m_to << m_stateAltered << m_altered << m_earliest << m_latest << m_max << m_skip;
@@ -69,12 +72,16 @@ Client::Client(std::string const& _clientVersion, Address _us, std::string const
 	m_stateDB(State::openDB(_dbPath, !m_vc.ok() || _forceClean)),
 	m_preMine(_us, m_stateDB),
 	m_postMine(_us, m_stateDB),
-	m_workState(Deleted)
+	m_workState(Deleted),
+	m_abortMining(false),
+	m_restartMining(false)
 {
 	if (_dbPath.size())
 		Defaults::setDBPath(_dbPath);
 	m_vc.setOk();
 	work(true);
+	WriteGuard l(x_stateDB);
+	publishSnapshot();
 }
 
 void Client::ensureWorking()
@@ -95,9 +102,19 @@ void Client::ensureWorking()
 			WriteGuard l(x_stateDB);
 			m_preMine.sync(m_bc);
 			m_postMine = m_preMine;
+			publishSnapshot();
 		}));
 }
 
+void Client::publishSnapshot()
+{
+	auto s = make_shared<StateSnapshot>();
+	s->db = m_stateDB;
+	s->preMine = m_preMine;
+	s->postMine = m_postMine;
+	atomic_store(&m_snapshot, shared_ptr<StateSnapshot const>(s));
+}
+
 Client::~Client()
 {
 	if (m_work)
@@ -127,6 +144,7 @@ void Client::clearPending()
 		appendFromNewPending(m_postMine.bloom(i), changeds);
 	changeds.insert(PendingChangedFilter);
 	m_postMine = m_preMine;
+	publishSnapshot();
 	noteChanged(changeds);
 }
 
@@ -277,6 +295,12 @@ void Client::setIdealPeerCount(size_t _n) const
 		return m_net->setIdealPeerCount(_n);
 }
 
+NetworkTraffic Client::networkTraffic() const
+{
+	ReadGuard l(x_net);
+	return m_net ? m_net->traffic() : NetworkTraffic();
+}
+
 bytes Client::savePeers()
 {
 	ReadGuard l(x_net);
@@ -311,6 +335,51 @@ void Client::startMining()
 void Client::stopMining()
 {
 	m_doMine = false;
+	m_abortMining = true;
+}
+
+WorkPackage Client::getWork()
+{
+	ensureWorking();
+
+	lock_guard<mutex> l(x_remoteWork);
+	// If nobody's asked in a while, whatever's committed for mining may be stale.
+	if (chrono::steady_clock::now() - m_lastGetWork > c_remoteMiningTimeout)
+		m_restartMining = true;
+	m_lastGetWork = chrono::steady_clock::now();
+	return m_remoteWork;
+}
+
+bool Client::submitWork(h256 const& _headerHash, h256 const& _nonce)
+{
+	lock_guard<mutex> l(x_remoteWork);
+	if (!_headerHash || _headerHash != m_remoteWork.headerHash || !Dagger::verify(_headerHash, _nonce, m_remoteDifficulty))
+		return false;
+	m_remoteSolution = _nonce;
+	m_haveRemoteSolution = true;
+	m_abortMining = true;
+	return true;
+}
+
+bool Client::remoteMining() const
+{
+	lock_guard<mutex> l(x_remoteWork);
+	return chrono::steady_clock::now() - m_lastGetWork < c_remoteMiningTimeout;
+}
+
+void Client::importMined(h256Set& o_changed)
+{
+	cwork << "COMPLETE MINE";
+	m_postMine.completeMine();
+	cwork << "CHAIN <== postSTATE";
+	h256s hs = m_bc.attemptImport(m_postMine.blockData(), m_stateDB);
+	if (hs.size())
+	{
+		for (auto h: hs)
+			appendFromNewBlock(h, o_changed);
+		o_changed.insert(ChainChangedFilter);
+		//o_changed.insert(PendingChangedFilter);	// if we mined the new block, then we've probably reset the pending transactions.
+	}
 }
 
 void Client::transact(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice)
@@ -319,10 +388,7 @@ void Client::transact(Secret _secret, u256 _value, Address _dest, bytes const& _
 
 	Transaction t;
 //	cdebug << "Nonce at " << toAddress(_secret) << " pre:" << m_preMine.transactionsFrom(toAddress(_secret)) << " post:" << m_postMine.transactionsFrom(toAddress(_secret));
-	{
-		ReadGuard l(x_stateDB);
-		t.nonce = m_postMine.transactionsFrom(toAddress(_secret));
-	}
+	t.nonce = postState().transactionsFrom(toAddress(_secret));
 	t.value = _value;
 	t.gasPrice = _gasPrice;
 	t.gas = _gas;
@@ -330,19 +396,16 @@ void Client::transact(Secret _secret, u256 _value, Address _dest, bytes const& _
 	t.data = _data;
 	t.sign(_secret);
 	cnote << "New transaction " << t;
-	m_tq.attemptImport(t.rlp());
+	if (m_tq.attemptImport(t.rlp()))
+		m_abortMining = true;
 }
 
 bytes Client::call(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice)
 {
-	State temp;
+	State temp = postState();
 	Transaction t;
 //	cdebug << "Nonce at " << toAddress(_secret) << " pre:" << m_preMine.transactionsFrom(toAddress(_secret)) << " post:" << m_postMine.transactionsFrom(toAddress(_secret));
-	{
-		ReadGuard l(x_stateDB);
-		temp = m_postMine;
-		t.nonce = temp.transactionsFrom(toAddress(_secret));
-	}
+	t.nonce = temp.transactionsFrom(toAddress(_secret));
 	t.value = _value;
 	t.gasPrice = _gasPrice;
 	t.gas = _gas;
@@ -360,10 +423,7 @@ Address Client::transact(Secret _secret, u256 _endowment, bytes const& _init, u2
 	ensureWorking();
 
 	Transaction t;
-	{
-		ReadGuard l(x_stateDB);
-		t.nonce = m_postMine.transactionsFrom(toAddress(_secret));
-	}
+	t.nonce = postState().transactionsFrom(toAddress(_secret));
 	t.value = _endowment;
 	t.gasPrice = _gasPrice;
 	t.gas = _gas;
@@ -371,7 +431,8 @@ Address Client::transact(Secret _secret, u256 _endowment, bytes const& _init, u2
 	t.data = _init;
 	t.sign(_secret);
 	cnote << "New transaction " << t;
-	m_tq.attemptImport(t.rlp());
+	if (m_tq.attemptImport(t.rlp()))
+		m_abortMining = true;
 	return right160(sha3(rlpList(t.sender(), t.nonce)));
 }
 
@@ -379,7 +440,16 @@ void Client::inject(bytesConstRef _rlp)
 {
 	ensureWorking();
 
-	m_tq.attemptImport(_rlp);
+	if (m_tq.attemptImport(_rlp))
+		m_abortMining = true;
+}
+
+void Client::injectBlock(bytesConstRef _rlp)
+{
+	ensureWorking();
+
+	if (m_bq.import(_rlp, m_bc) == BlockImportResult::Success)
+		m_abortMining = true;
 }
 
 void Client::workNet()
@@ -396,8 +466,14 @@ void Client::workNet()
 
 			// returns h256Set as block hashes, once for each block that has come in/gone out.
 			cwork << "NET <==> TQ ; CHAIN ==> NET ==> BQ";
+			auto tqBefore = m_tq.items();
+			auto bqBefore = m_bq.items();
 			m_net->sync(m_tq, m_bq);
 
+			// Anything new means what we're mining is out of date; don't wait for the round to time out.
+			if (m_tq.items() != tqBefore || m_bq.items() != bqBefore)
+				m_abortMining = true;
+
 			cwork << "TQ:" << m_tq.items() << "; BQ:" << m_bq.items();
 		}
 	}
@@ -408,73 +484,97 @@ void Client::work(bool _justQueue)
 {
 	cworkin << "WORK";
 	h256Set changeds;
+	bool republish = false;
 
 	// Do some mining.
 	if (!_justQueue && (m_pendingCount || m_forceMining))
 	{
 
 		// TODO: Separate "Miner" object.
-		if (m_doMine)
+		if ((m_doMine || remoteMining()) && m_restartMining)
 		{
-			if (m_restartMining)
+			m_mineProgress.best = (double)-1;
+			m_mineProgress.hashes = 0;
+			m_mineProgress.ms = 0;
+			WriteGuard l(x_stateDB);
+			bool committed = true;
+			if (m_paranoia)
 			{
-				m_mineProgress.best = (double)-1;
-				m_mineProgress.hashes = 0;
-				m_mineProgress.ms = 0;
-				WriteGuard l(x_stateDB);
-				if (m_paranoia)
+				if (m_postMine.amIJustParanoid(m_bc))
 				{
-					if (m_postMine.amIJustParanoid(m_bc))
-					{
-						cnote << "I'm just paranoid. Block is fine.";
-						m_postMine.commitToMine(m_bc);
-					}
-					else
-					{
-						cwarn << "I'm not just paranoid. Cannot mine. Please file a bug report.";
-						m_doMine = false;
-					}
+					cnote << "I'm just paranoid. Block is fine.";
+					m_postMine.commitToMine(m_bc);
 				}
 				else
-					m_postMine.commitToMine(m_bc);
+				{
+					cwarn << "I'm not just paranoid. Cannot mine. Please file a bug report.";
+					m_doMine = false;
+					committed = false;
+					// Don't retry each time round, nor leave work out for a block that won't be mined.
+					m_restartMining = false;
+					lock_guard<mutex> l(x_remoteWork);
+					m_remoteWork = WorkPackage();
+					m_haveRemoteSolution = false;
+				}
+			}
+			else
+				m_postMine.commitToMine(m_bc);
+
+			if (committed)
+			{
+				m_restartMining = false;
+				republish = true;
+				h256 header = m_postMine.prepareWork();
+				lock_guard<mutex> l(x_remoteWork);
+				m_remoteWork = WorkPackage{header, Dagger::boundary(m_postMine.info().difficulty)};
+				m_remoteDifficulty = m_postMine.info().difficulty;
+				m_haveRemoteSolution = false;
 			}
 		}
 
-		if (m_doMine)
+		bool haveSolution;
+		h256 solutionFor;
+		h256 solution;
+		{
+			lock_guard<mutex> l(x_remoteWork);
+			haveSolution = m_haveRemoteSolution && !m_restartMining;
+			solutionFor = m_remoteWork.headerHash;
+			solution = m_remoteSolution;
+			m_haveRemoteSolution = false;
+		}
+
+		if (haveSolution)
+		{
+			cwork << "REMOTE MINE";
+			WriteGuard l(x_stateDB);
+			// Make sure it's still for the block we've got.
+			if (m_postMine.prepareWork() == solutionFor && m_postMine.submitWork(solution))
+				importMined(changeds);
+		}
+		else if (m_doMine)
 		{
 			cwork << "MINE";
-			m_restartMining = false;
 
 			// Mine for a while.
-			MineInfo mineInfo = m_postMine.mine(100, m_turboMining);
+			MineInfo mineInfo = m_postMine.mine(100, m_turboMining, m_miningThreads, &m_abortMining);
 
 			m_mineProgress.best = min(m_mineProgress.best, mineInfo.best);
 			m_mineProgress.current = mineInfo.best;
 			m_mineProgress.requirement = mineInfo.requirement;
-			m_mineProgress.ms += 100;
+			m_mineProgress.ms += mineInfo.ms;
 			m_mineProgress.hashes += mineInfo.hashes;
+			m_mineProgress.threads = m_miningThreads;
 			WriteGuard l(x_stateDB);
 			m_mineHistory.push_back(mineInfo);
 			if (mineInfo.completed)
-			{
-				// Import block.
-				cwork << "COMPLETE MINE";
-				m_postMine.completeMine();
-				cwork << "CHAIN <== postSTATE";
-				h256s hs = m_bc.attemptImport(m_postMine.blockData(), m_stateDB);
-				if (hs.size())
-				{
-					for (auto h: hs)
-						appendFromNewBlock(h, changeds);
-					changeds.insert(ChainChangedFilter);
-					//changeds.insert(PendingChangedFilter);	// if we mined the new block, then we've probably reset the pending transactions.
-				}
-			}
+				importMined(changeds);
 		}
 		else
 		{
+			// Wake early if an external miner hands something in.
 			cwork << "SLEEP";
-			this_thread::sleep_for(chrono::milliseconds(100));
+			for (unsigned i = 0; i < 10 && !m_abortMining; ++i)
+				this_thread::sleep_for(chrono::milliseconds(10));
 		}
 	}
 	else
@@ -493,6 +593,9 @@ void Client::work(bool _justQueue)
 	{
 		WriteGuard l(x_stateDB);
 
+		// Anything that turns up from here on is news to the next round of mining.
+		m_abortMining = false;
+
 		cwork << "BQ ==> CHAIN ==> STATE";
 		OverlayDB db = m_stateDB;
 		x_stateDB.unlock();
@@ -513,7 +616,11 @@ void Client::work(bool _justQueue)
 			if (m_doMine)
 				cnote << "New block on chain: Restarting mining operation.";
 			m_restartMining = true;	// need to re-commit to mine.
+			// Carry over what pending transactions we can rather than executing them all again from the queue.
+			State old = m_postMine;
 			m_postMine = m_preMine;
+			for (auto i: m_postMine.rebase(old))
+				appendFromNewPending(i, changeds);
 			changeds.insert(PendingChangedFilter);
 		}
 
@@ -531,6 +638,10 @@ void Client::work(bool _justQueue)
 			m_restartMining = true;
 		}
 		m_pendingCount = m_postMine.pending().size();
+
+		// Anything that changed a state changed a filter, other than (re)committing to mine.
+		if (republish || changeds.size())
+			publishSnapshot();
 	}
 
 	cwork << "noteChanged" << changeds.size() << "items";
@@ -550,31 +661,34 @@ unsigned Client::numberOf(int _n) const
 
 State Client::asOf(int _h) const
 {
-	ReadGuard l(x_stateDB);
+	auto s = snapshot();
 	if (_h == 0)
-		return m_postMine;
+		return s->postMine;
 	else if (_h == -1)
-		return m_preMine;
+		return s->preMine;
 	else
-		return State(m_stateDB, m_bc, m_bc.numberHash(numberOf(_h)));
+		return State(s->db, m_bc, m_bc.numberHash(numberOf(_h)));
+}
+
+StateView Client::stateAfter(int _h) const
+{
+	h256 root = BlockInfo(m_bc.block(m_bc.numberHash(numberOf(_h)))).stateRoot;
+	return StateView(snapshot()->db, root);
 }
 
 State Client::state(unsigned _txi, h256 _block) const
 {
-	ReadGuard l(x_stateDB);
-	return State(m_stateDB, m_bc, _block).fromPending(_txi);
+	return State(snapshot()->db, m_bc, _block).fromPending(_txi);
 }
 
 eth::State Client::state(h256 _block) const
 {
-	ReadGuard l(x_stateDB);
-	return State(m_stateDB, m_bc, _block);
+	return State(snapshot()->db, m_bc, _block);
 }
 
 eth::State Client::state(unsigned _txi) const
 {
-	ReadGuard l(x_stateDB);
-	return m_postMine.fromPending(_txi);
+	return snapshot()->postMine.fromPending(_txi);
 }
 
 StateDiff Client::diff(unsigned _txi, int _block) const
@@ -592,34 +706,36 @@ StateDiff Client::diff(unsigned _txi, h256 _block) const
 std::vector<Address> Client::addresses(int _block) const
 {
 	vector<Address> ret;
-	for (auto const& i: asOf(_block).addresses())
+	for (auto const& i: _block ? stateAfter(_block).addresses() : asOf(_block).addresses())
 		ret.push_back(i.first);
 	return ret;
 }
 
+// Anything but the pending state is on the chain, so can be read straight from its trie.
+
 u256 Client::balanceAt(Address _a, int _block) const
 {
-	return asOf(_block).balance(_a);
+	return _block ? stateAfter(_block).balance(_a) : asOf(_block).balance(_a);
 }
 
 std::map<u256, u256> Client::storageAt(Address _a, int _block) const
 {
-	return asOf(_block).storage(_a);
+	return _block ? stateAfter(_block).storage(_a) : asOf(_block).storage(_a);
 }
 
 u256 Client::countAt(Address _a, int _block) const
 {
-	return asOf(_block).transactionsFrom(_a);
+	return _block ? stateAfter(_block).transactionsFrom(_a) : asOf(_block).transactionsFrom(_a);
 }
 
 u256 Client::stateAt(Address _a, u256 _l, int _block) const
 {
-	return asOf(_block).storage(_a, _l);
+	return _block ? stateAfter(_block).storage(_a, _l) : asOf(_block).storage(_a, _l);
 }
 
 bytes Client::codeAt(Address _a, int _block) const
 {
-	return asOf(_block).code(_a);
+	return _block ? stateAfter(_block).code(_a) : asOf(_block).code(_a);
 }
 
 bool MessageFilter::matches(h256 _bloom) const
@@ -686,6 +802,20 @@ bool MessageFilter::matches(State const& _s, unsigned _i) const
 	return true;
 }
 
+std::set<Address> MessageFilter::anchors() const
+{
+	std::set<Address> altered = m_altered;
+	for (auto const& i: m_stateAltered)
+		altered.insert(i.first);
+
+	// Any one of the constraints will do; the fewest addresses makes for the fewest candidates.
+	std::set<Address> ret;
+	for (auto const* i: { &m_from, &m_to, (std::set<Address> const*)&altered })
+		if (!i->empty() && (ret.empty() || i->size() < ret.size()))
+			ret = *i;
+	return ret;
+}
+
 PastMessages MessageFilter::matches(Manifest const& _m, unsigned _i) const
 {
 	PastMessages ret;
@@ -744,11 +874,12 @@ PastMessages Client::messages(MessageFilter const& _f) const
 	// Handle pending transactions differently as they're not on the block chain.
 	if (begin == m_bc.number())
 	{
-		ReadGuard l(x_stateDB);
-		for (unsigned i = 0; i < m_postMine.pending().size(); ++i)
+		auto snap = snapshot();
+		State const& postMine = snap->postMine;
+		for (unsigned i = 0; i < postMine.pending().size(); ++i)
 		{
 			// Might have a transaction that contains a matching message.
-			Manifest const& ms = m_postMine.changesFromPending(i);
+			Manifest const& ms = postMine.changesFromPending(i);
 			PastMessages pm = _f.matches(ms, i);
 			if (pm.size())
 			{
@@ -758,11 +889,45 @@ PastMessages Client::messages(MessageFilter const& _f) const
 						s--;
 					else
 						// Have a transaction that contains a matching message.
-						ret.insert(ret.begin(), pm[j].polish(h256(), ts, m_bc.number() + 1, m_postMine.address()));
+						ret.insert(ret.begin(), pm[j].polish(h256(), ts, m_bc.number() + 1, postMine.address()));
+			}
+		}
+	}
+
+	// Use the address index if the filter lets us; it gives exactly the transactions to look at.
+	set<Address> anchors = _f.anchors();
+	if (!anchors.empty())
+	{
+		map<uint, set<unsigned>> found;
+		if (begin > end)
+			for (auto const& a: anchors)
+				m_bc.involving(a, end + 1, begin, found);
+		for (auto b = found.rbegin(); b != found.rend() && ret.size() != m; ++b)
+		{
+			auto h = m_bc.numberHash(b->first);
+			Manifests ms = m_bc.traces(h).traces;
+			BlockInfo bi;
+			for (auto i: b->second)
+			{
+				if (i >= ms.size())
+					continue;
+				PastMessages pm = _f.matches(ms[i], i);
+				if (pm.size())
+				{
+					if (!bi)
+						bi.populate(m_bc.block(h));
+					for (unsigned j = 0; j < pm.size() && ret.size() != m; ++j)
+						if (s)
+							s--;
+						else
+							ret.push_back(pm[j].polish(h, bi.timestamp, b->first, bi.coinbaseAddress));
+				}
 			}
 		}
+		return ret;
 	}
 
+	// Otherwise scan the chain, using the blooms to skip what we can.
 #if ETH_DEBUG
 	unsigned skipped = 0;
 	unsigned falsePos = 0;
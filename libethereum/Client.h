@@ -25,6 +25,7 @@
 #include <mutex>
 #include <list>
 #include <atomic>
+#include <memory>
 #include <boost/utility.hpp>
 #include <libethential/Common.h>
 #include <libethential/CommonIO.h>
@@ -46,10 +47,30 @@ struct MineProgress
 	double current;
 	uint hashes;
 	uint ms;
+	unsigned threads;
+	/// @returns the aggregate hash rate across all mining threads, in hashes per second.
+	double rate() const { return ms ? hashes * 1000.0 / ms : 0; }
+};
+
+/// A block for an external miner to work on: it must find a nonce for which Dagger::eval(headerHash, nonce) is
+/// no greater than boundary.
+struct WorkPackage
+{
+	h256 headerHash;		///< Hash of the block's header without the nonce; zero if there's nothing to mine.
+	u256 boundary;
 };
 
 class Client;
 
+/// The client's states as of some point, published by the work thread for everyone else to read.
+/// Never altered once published; queries that fill a State's cache must be made on a copy.
+struct StateSnapshot
+{
+	OverlayDB db;			///< The state database.
+	State preMine;			///< The state at the head of the chain.
+	State postMine;			///< The state with our pending transactions (and mining rewards) on top.
+};
+
 enum ClientWorkState
 {
 	Active = 0,
@@ -110,6 +131,10 @@ public:
 	bool matches(State const& _s, unsigned _i) const;
 	PastMessages matches(Manifest const& _m, unsigned _i) const;
 
+	/// @returns addresses at least one of which every matching message's transaction involves as a sender or recipient,
+	/// or nothing if the filter doesn't narrow things down that way.
+	std::set<Address> anchors() const;
+
 	MessageFilter from(Address _a) { m_from.insert(_a); return *this; }
 	MessageFilter to(Address _a) { m_to.insert(_a); return *this; }
 	MessageFilter altered(Address _a, u256 _l) { m_stateAltered.insert(std::make_pair(_a, _l)); return *this; }
@@ -153,13 +178,13 @@ struct ClientWatch
 };
 
 struct WatchChannel: public LogChannel { static const char* name() { return "(o)"; } static const int verbosity = 7; };
-#define cwatch eth::LogOutputStream<eth::WatchChannel, true>()
+#define cwatch ETH_LOG_GUARD(eth::WatchChannel) eth::LogOutputStream<eth::WatchChannel, true>()
 struct WorkInChannel: public LogChannel { static const char* name() { return ">W>"; } static const int verbosity = 16; };
 struct WorkOutChannel: public LogChannel { static const char* name() { return "<W<"; } static const int verbosity = 16; };
 struct WorkChannel: public LogChannel { static const char* name() { return "-W-"; } static const int verbosity = 16; };
-#define cwork eth::LogOutputStream<eth::WorkChannel, true>()
-#define cworkin eth::LogOutputStream<eth::WorkInChannel, true>()
-#define cworkout eth::LogOutputStream<eth::WorkOutChannel, true>()
+#define cwork ETH_LOG_GUARD(eth::WorkChannel) eth::LogOutputStream<eth::WorkChannel, true>()
+#define cworkin ETH_LOG_GUARD(eth::WorkInChannel) eth::LogOutputStream<eth::WorkInChannel, true>()
+#define cworkout ETH_LOG_GUARD(eth::WorkOutChannel) eth::LogOutputStream<eth::WorkOutChannel, true>()
 
 /**
  * @brief Main API hub for interfacing with Ethereum.
@@ -183,6 +208,9 @@ public:
 	/// Injects the RLP-encoded transaction given by the _rlp into the transaction queue directly.
 	void inject(bytesConstRef _rlp);
 
+	/// Injects the RLP-encoded block given by the _rlp into the block queue directly.
+	void injectBlock(bytesConstRef _rlp);
+
 	/// Blocks until all pending transactions have been processed.
 	void flushTransactions();
 
@@ -221,7 +249,7 @@ public:
 
 	/// Get a map containing each of the pending transactions.
 	/// @TODO: Remove in favour of transactions().
-	Transactions pending() const { return m_postMine.pending(); }
+	Transactions pending() const { return snapshot()->postMine.pending(); }
 
 	/// Differences between transactions.
 	StateDiff diff(unsigned _txi) const { return diff(_txi, m_default); }
@@ -236,7 +264,7 @@ public:
 	static u256 txGas(uint _dataCount, u256 _gas = 0) { return c_txDataGas * _dataCount + c_txGas + _gas; }
 
 	/// Get the remaining gas limit in this block.
-	u256 gasLimitRemaining() const { return m_postMine.gasLimitRemaining(); }
+	u256 gasLimitRemaining() const { return snapshot()->postMine.gasLimitRemaining(); }
 
 	// [PRIVATE API - only relevant for base clients, not available in general]
 
@@ -245,10 +273,15 @@ public:
 	eth::State state(unsigned _txi) const;
 
 	/// Get the object representing the current state of Ethereum.
-	eth::State postState() const { ReadGuard l(x_stateDB); return m_postMine; }
+	eth::State postState() const { return snapshot()->postMine; }
 	/// Get the object representing the current canonical blockchain.
 	BlockChain const& blockChain() const { return m_bc; }
 
+	/// Get what's in the transaction queue and what's been admitted to, rejected from and evicted from it.
+	TransactionQueueStatus transactionQueueStatus() const { return m_tq.status(); }
+	/// Set how much the transaction queue may hold.
+	void setTransactionQueueLimits(TransactionQueueLimits const& _limits) { m_tq.setLimits(_limits); }
+
 	// Misc stuff:
 
 	void setClientVersion(std::string const& _name) { m_clientVersion = _name; }
@@ -261,6 +294,8 @@ public:
 	size_t peerCount() const;
 	/// Same as peers().size(), but more efficient.
 	void setIdealPeerCount(size_t _n) const;
+	/// Get the totals of traffic exchanged with peers; all zero if the network isn't up.
+	NetworkTraffic networkTraffic() const;
 
 	/// Start the network subsystem.
 	void startNetwork(unsigned short _listenPort = 30303, std::string const& _remoteHost = std::string(), unsigned short _remotePort = 30303, NodeMode _mode = NodeMode::Full, unsigned _peers = 5, std::string const& _publicIP = std::string(), bool _upnp = true, u256 _networkId = 0);
@@ -307,6 +342,21 @@ public:
 	void setTurboMining(bool _enable = true) { m_turboMining = _enable; }
 	bool turboMining() const { return m_turboMining; }
 
+	/// Get the block for an external miner to work on. So long as someone keeps asking, blocks are prepared for
+	/// mining whether or not we're mining ourselves. The header hash is zero if there's nothing ready yet.
+	WorkPackage getWork();
+	/// Hand in a nonce found by an external miner for the package @a _headerHash from getWork().
+	/// @returns true iff it solves the current package, in which case the block will be imported shortly.
+	bool submitWork(h256 const& _headerHash, h256 const& _nonce);
+
+	/// Set the number of threads to mine with; 0 means one per hardware thread.
+	void setMiningThreads(unsigned _threads) { m_miningThreads = _threads ? _threads : std::max(1u, std::thread::hardware_concurrency()); }
+	unsigned miningThreads() const { return m_miningThreads; }
+
+	/// Set the number of threads to execute imported blocks' transactions on; 0 means one per hardware thread.
+	void setImportThreads(unsigned _threads) { m_bc.setImportThreads(_threads ? _threads : std::thread::hardware_concurrency()); }
+	unsigned importThreads() const { return m_bc.importThreads(); }
+
 private:
 	/// Ensure the worker thread is running. Needed for blockchain maintenance & mining.
 	void ensureWorking();
@@ -318,6 +368,18 @@ private:
 	/// Do some work on the network.
 	void workNet();
 
+	/// Publish copies of the states for readers. x_stateDB must be locked.
+	void publishSnapshot();
+	/// @returns the states as last published. Never waits on the work thread.
+	std::shared_ptr<StateSnapshot const> snapshot() const { return std::atomic_load(&m_snapshot); }
+
+	/// Has an external miner asked for work lately?
+	bool remoteMining() const;
+
+	/// Build the block in m_postMine, which has been given a valid nonce, and import it.
+	/// Insert any filters that are activated into @a o_changed. x_stateDB must be write-locked.
+	void importMined(h256Set& o_changed);
+
 	/// Collate the changed filters for the bloom filter of the given pending transaction.
 	/// Insert any filters that are activated into @a o_changed.
 	void appendFromNewPending(h256 _pendingTransactionBloom, h256Set& o_changed) const;
@@ -335,16 +397,20 @@ private:
 
 	State asOf(int _h) const;
 	State asOf(unsigned _h) const;
+	/// @returns a read-only view of the state as of the end of block @a _h (numbered as for numberOf()), read
+	/// straight from the state trie with the root from its header.
+	StateView stateAfter(int _h) const;
 
 	std::string m_clientVersion;			///< Our end-application client's name/version.
 	VersionChecker m_vc;					///< Dummy object to check & update the protocol version.
 	BlockChain m_bc;						///< Maintains block database.
 	TransactionQueue m_tq;					///< Maintains a list of incoming transactions not yet in a block on the blockchain.
 	BlockQueue m_bq;						///< Maintains a list of incoming blocks not yet on the blockchain (to be imported).
-	mutable boost::shared_mutex x_stateDB;	// TODO: remove in favour of copying m_stateDB as required and thread-safing/copying State. Have a good think about what state objects there should be. Probably want 4 (pre, post, mining, user-visible).
+	mutable boost::shared_mutex x_stateDB;	///< Serialises changes to the states below. Readers use m_snapshot instead.
 	OverlayDB m_stateDB;					///< Acts as the central point for the state database, so multiple States can share it.
 	State m_preMine;						///< The present state of the client.
 	State m_postMine;						///< The state of the client which we're mining (i.e. it'll have all the rewards added).
+	std::shared_ptr<StateSnapshot const> m_snapshot;	///< Copies of the above for readers; only ever swapped with std::atomic_store.
 
 	std::unique_ptr<std::thread> m_workNet;	///< The network thread.
 	std::atomic<ClientWorkState> m_workNetState;
@@ -358,9 +424,18 @@ private:
 	bool m_doMine = false;					///< Are we supposed to be mining?
 	bool m_turboMining = false;				///< Don't squander all of our time mining actually just sleeping.
 	bool m_forceMining = false;				///< Mine even when there are no transactions pending?
+	unsigned m_miningThreads = 1;			///< How many threads to mine with.
+	std::atomic<bool> m_abortMining;		///< Set when there's new work, so the current round of mining gives up early.
+
+	mutable std::mutex x_remoteWork;		///< Lock for the external mining fields below.
+	WorkPackage m_remoteWork;				///< What we're handing out to external miners.
+	u256 m_remoteDifficulty;				///< The difficulty m_remoteWork was made for.
+	h256 m_remoteSolution;					///< A nonce handed in for m_remoteWork; valid iff m_haveRemoteSolution.
+	bool m_haveRemoteSolution = false;
+	std::chrono::steady_clock::time_point m_lastGetWork;	///< When an external miner last asked for work.
 	MineProgress m_mineProgress;
 	std::list<MineInfo> m_mineHistory;
-	mutable bool m_restartMining = false;
+	mutable std::atomic<bool> m_restartMining;	///< Set by RPC and remote-mining calls as well as the work loop, so atomic.
 	mutable unsigned m_pendingCount = 0;
 
 	mutable std::mutex m_filterLock;
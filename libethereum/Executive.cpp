@@ -33,7 +33,7 @@ Executive::~Executive()
 {
 	// TODO: Make safe.
 	delete m_ext;
-	delete m_vm;
+	VMPool::give(m_vm);
 }
 
 u256 Executive::gasUsed() const
@@ -42,9 +42,14 @@ u256 Executive::gasUsed() const
 }
 
 bool Executive::setup(bytesConstRef _rlp)
+{
+	return setup(Transaction(_rlp));
+}
+
+bool Executive::setup(Transaction const& _t)
 {
 	// Entry point for a user-executed transaction.
-	m_t = Transaction(_rlp);
+	m_t = _t;
 
 	m_sender = m_t.sender();
 
@@ -116,7 +121,7 @@ bool Executive::call(Address _receiveAddress, Address _senderAddress, u256 _valu
 
 	if (m_s.addressHasCode(_receiveAddress))
 	{
-		m_vm = new VM(_gas);
+		m_vm = VMPool::take(_gas);
 		bytes const& c = m_s.code(_receiveAddress);
 		m_ext = new ExtVM(m_s, _receiveAddress, _senderAddress, _originAddress, _value, _gasPrice, _data, &c, m_ms);
 	}
@@ -137,7 +142,7 @@ bool Executive::create(Address _sender, u256 _endowment, u256 _gasPrice, u256 _g
 	m_s.m_cache[m_newAddress] = AddressState(0, _endowment, h256(), h256());
 
 	// Execute _init.
-	m_vm = new VM(_gas);
+	m_vm = VMPool::take(_gas);
 	m_ext = new ExtVM(m_s, m_newAddress, _sender, _origin, _endowment, _gasPrice, bytesConstRef(), _init, m_ms);
 	return _init.empty();
 }
@@ -146,6 +151,8 @@ OnOpFunc Executive::simpleTrace()
 {
 	return [](uint64_t steps, Instruction inst, bigint newMemSize, bigint gasCost, void* voidVM, void const* voidExt)
 	{
+		if (!isChannelVisible<VMTraceChannel>())
+			return;
 		ExtVM const& ext = *(ExtVM const*)voidExt;
 		VM& vm = *(VM*)voidVM;
 
@@ -45,6 +45,8 @@ public:
 	~Executive();
 
 	bool setup(bytesConstRef _transaction);
+	/// Like setup(bytesConstRef) but for a transaction that's already decoded; its sender won't be recovered again if it's known.
+	bool setup(Transaction const& _transaction);
 	bool create(Address _txSender, u256 _endowment, u256 _gasPrice, u256 _gas, bytesConstRef _code, Address _originAddress);
 	bool call(Address _myAddress, Address _txSender, u256 _txValue, u256 _gasPrice, bytesConstRef _txData, u256 _gas, Address _originAddress);
 	bool go(OnOpFunc const& _onOp = OnOpFunc());
@@ -67,7 +69,7 @@ public:
 private:
 	State& m_s;
 	ExtVM* m_ext = nullptr;	// TODO: make safe.
-	VM* m_vm = nullptr;
+	VM* m_vm = nullptr;		///< From the VMPool.
 	Manifest* m_ms = nullptr;
 	bytesConstRef m_out;
 	Address m_newAddress;
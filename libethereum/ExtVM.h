@@ -41,6 +41,8 @@ public:
 		ExtVMFace(_myAddress, _caller, _origin, _value, _gasPrice, _data, _code, _s.m_previousBlock, _s.m_currentBlock), level(_level), m_s(_s), m_origCache(_s.m_cache), m_ms(o_ms)
 	{
 		m_s.ensureCached(_myAddress, true, true);
+		if (m_s.m_access)
+			m_s.m_access->ranCode = true;
 	}
 
 	/// Read storage location.
@@ -41,6 +41,14 @@ static const eth::uint c_maxHashes = 32;		///< Maximum number of hashes BlockHas
 static const eth::uint c_maxHashesAsk = 32;	///< Maximum number of hashes GetBlockHashes will ever ask for.
 static const eth::uint c_maxBlocks = 16;		///< Maximum number of blocks Blocks will ever send.
 static const eth::uint c_maxBlocksAsk = 16;	///< Maximum number of blocks we ask to receive in Blocks (when using GetChain).
+static const eth::uint c_maxHeaders = 256;		///< Maximum number of headers BlockHeaders will ever send.
+static const eth::uint c_maxHeadersAsk = 256;	///< Maximum number of headers we ask to receive in BlockHeaders.
+static const eth::uint c_readChunkSize = 65536;	///< Minimum space we offer to each read from a peer's socket.
+static const eth::uint c_maxInvalid = 8;		///< Number of bad blocks or transactions we tolerate from a peer before disconnecting it.
+static const eth::uint c_compressionThreshold = 1024;	///< Payload size in bytes from which we bother compressing a packet.
+static const eth::uint c_compressionCap = 0x08;	///< Hello caps bit: the peer understands CompressedPacket.
+static const eth::uint c_headersCap = 0x10;		///< Hello caps bit: the peer answers GetBlockHeaders, so we can sync from it header-first.
+static const eth::uint c_maxPacketSize = 16 * 1024 * 1024;	///< Maximum payload of a single packet we are willing to buffer from a peer; anything larger is treated as a protocol violation.
 
 class OverlayDB;
 class BlockChain;
@@ -75,6 +83,9 @@ enum PacketType
 	GetBlockHashesPacket,
 	BlockHashesPacket,
 	GetBlocksPacket,
+	CompressedPacket,		///< Another packet's payload, snappy-compressed. Only sent to peers advertising c_compressionCap.
+	GetBlockHeadersPacket,	///< Ask for the headers of the given blocks, earliest first. Only sent to peers advertising c_headersCap.
+	BlockHeadersPacket,		///< Headers in the order asked for, stopping at the first block we don't have.
 };
 
 enum DisconnectReason
@@ -93,12 +104,40 @@ enum DisconnectReason
 /// @returns the string form of the given disconnection reason.
 std::string reasonOf(DisconnectReason _r);
 
+/// Totals of the traffic a node has exchanged with all of its peers. Byte counts include packet framing.
+/// The payload counts are of packets as interpreted or constructed, i.e. before compression and after
+/// decompression, so payloadBytesOut / bytesOut is the compression ratio achieved.
+struct NetworkTraffic
+{
+	uint64_t bytesIn = 0;
+	uint64_t bytesOut = 0;
+	uint64_t packetsIn = 0;
+	uint64_t packetsOut = 0;
+	uint64_t payloadBytesIn = 0;
+	uint64_t payloadBytesOut = 0;
+};
+
+/// What a single peer has cost us and what it has given us in return, since it connected.
+struct PeerMetrics
+{
+	uint64_t bytesIn = 0;					///< Bytes received, including framing.
+	uint64_t bytesOut = 0;					///< Bytes sent, including framing.
+	unsigned usefulBlocks = 0;				///< Blocks received that we didn't already have.
+	unsigned duplicateBlocks = 0;			///< Blocks received that we already had.
+	unsigned usefulTransactions = 0;		///< Transactions received that we didn't already have.
+	unsigned duplicateTransactions = 0;		///< Transactions received that we already had.
+	unsigned invalid = 0;					///< Packets, blocks or transactions received that turned out to be bad.
+	std::chrono::steady_clock::duration latency = std::chrono::steady_clock::duration(0);	///< Smoothed round-trip time of pings and block requests; zero if not yet known.
+	int score = 0;							///< Overall worth of the peer; the lowest scoring peers are the first to go.
+};
+
 struct PeerInfo
 {
 	std::string clientVersion;
 	std::string host;
 	unsigned short port;
 	std::chrono::steady_clock::duration lastPing;
+	PeerMetrics metrics;
 };
 
 class UPnP;
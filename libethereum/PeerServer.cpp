@@ -416,14 +416,14 @@ bool PeerServer::ensureInitialised(TransactionQueue& _tq)
 	return false;
 }
 
-bool PeerServer::noteBlock(h256 _hash, bytesConstRef _data)
+bool PeerServer::noteBlock(h256 _hash, bytesConstRef _data, std::weak_ptr<PeerSession> const& _from)
 {
 	Guard l(x_blocksNeeded);
 	m_blocksOnWay.erase(_hash);
 	if (!m_chain->details(_hash))
 	{
 		lock_guard<recursive_mutex> l(m_incomingLock);
-		m_incomingBlocks.push_back(_data.toBytes());
+		m_incomingBlocks.push_back(make_pair(_data.toBytes(), _from));
 		return true;
 	}
 	return false;
@@ -458,10 +458,34 @@ void PeerServer::maintainTransactions(TransactionQueue& _tq, h256 _currentHash)
 	bool resendAll = (_currentHash != m_latestBlockSent);
 
 	for (auto it = m_incomingTransactions.begin(); it != m_incomingTransactions.end(); ++it)
-		if (_tq.import(&*it))
-		{}//ret = true;		// just putting a transaction in the queue isn't enough to change the state - it might have an invalid nonce...
+	{
+		auto h = sha3(it->first);
+		auto p = it->second.lock();
+		if (_tq.knows(h))
+		{
+			if (p)
+				p->m_metrics.duplicateTransactions++;
+			m_transactionsSent.insert(h);	// if we already had the transaction, then don't bother sending it on.
+		}
 		else
-			m_transactionsSent.insert(sha3(*it));	// if we already had the transaction, then don't bother sending it on.
+			switch (_tq.import(&it->first))
+			{
+			case ImportResult::Success:
+				// just putting a transaction in the queue isn't enough to change the state - it might have an invalid nonce...
+				if (p)
+					p->m_metrics.usefulTransactions++;
+				break;
+			case ImportResult::Malformed:
+				if (p)
+					p->noteInvalid();
+				m_transactionsSent.insert(h);
+				break;
+			default:
+				// Valid but we've no room for it; not the peer's fault, but no point passing it on either.
+				m_transactionsSent.insert(h);
+				break;
+			}
+	}
 	m_incomingTransactions.clear();
 
 	// Send any new transactions.
@@ -498,9 +522,34 @@ void PeerServer::maintainBlocks(BlockQueue& _bq, h256 _currentHash)
 	{
 		lock_guard<recursive_mutex> l(m_incomingLock);
 		for (auto it = m_incomingBlocks.rbegin(); it != m_incomingBlocks.rend(); ++it)
-			if (_bq.import(&*it, *m_chain))
-			{}
-			else{} // TODO: don't forward it.
+		{
+			auto h = sha3(it->first);
+			auto p = it->second.lock();
+			if (_bq.knows(h) || m_chain->details(h))
+			{
+				if (p)
+					p->m_metrics.duplicateBlocks++;
+			}
+			else
+				switch (_bq.import(&it->first, *m_chain))
+				{
+				case BlockImportResult::Success:
+					if (p)
+						p->m_metrics.usefulBlocks++;
+					break;
+				case BlockImportResult::Malformed:
+					if (p)	// TODO: don't forward it.
+						p->noteInvalid();
+					break;
+				case BlockImportResult::AlreadyKnown:
+					if (p)
+						p->m_metrics.duplicateBlocks++;
+					break;
+				default:
+					// Ahead of our clock; more likely skew than malice.
+					break;
+				}
+		}
 		m_incomingBlocks.clear();
 	}
 
@@ -560,7 +609,17 @@ void PeerServer::growPeers()
 			break;
 		}
 
-		auto x = time(0) % m_freePeers.size();
+		// Prefer whoever scored best last time we were connected; amongst equals, whoever we've tried least.
+		auto worth = [&](Public const& _id)
+		{
+			Guard l(x_peerScores);
+			auto it = m_peerScores.find(_id);
+			return make_pair(it == m_peerScores.end() ? 0 : it->second, -(int)m_incomingPeers[_id].second);
+		};
+		size_t x = 0;
+		for (size_t i = 1; i < m_freePeers.size(); ++i)
+			if (worth(m_freePeers[i]) > worth(m_freePeers[x]))
+				x = i;
 		m_incomingPeers[m_freePeers[x]].second++;
 		connect(m_incomingPeers[m_freePeers[x]].first);
 		m_freePeers.erase(m_freePeers.begin() + x);
@@ -602,10 +661,10 @@ void PeerServer::prunePeers()
 			unsigned agedPeers = 0;
 			for (auto i: m_peers)
 				if (auto p = i.second.lock())
-					if ((m_mode != NodeMode::PeerServer || p->m_caps != 0x01) && chrono::steady_clock::now() > p->m_connect + chrono::milliseconds(old))	// don't throw off new peers; peer-servers should never kick off other peer-servers.
+					if ((m_mode != NodeMode::PeerServer || (p->m_caps & 0x07) != 0x01) && chrono::steady_clock::now() > p->m_connect + chrono::milliseconds(old))	// don't throw off new peers; peer-servers should never kick off other peer-servers.
 					{
 						++agedPeers;
-						if ((!worst || p->m_rating < worst->m_rating || (p->m_rating == worst->m_rating && p->m_connect > worst->m_connect)))	// kill older ones
+						if ((!worst || p->rating() < worst->rating() || (p->rating() == worst->rating() && p->m_connect > worst->m_connect)))	// kill older ones
 							worst = p;
 					}
 			if (!worst || agedPeers <= m_idealPeerCount)
@@ -631,7 +690,10 @@ std::vector<PeerInfo> PeerServer::peers(bool _updatePing) const
 	for (auto& i: m_peers)
 		if (auto j = i.second.lock())
 			if (j->m_socket.is_open())
+			{
 				ret.push_back(j->m_info);
+				ret.back().metrics = j->metrics();
+			}
 	return ret;
 }
 
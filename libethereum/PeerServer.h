@@ -96,6 +96,9 @@ public:
 	/// Ping the peers, to update the latency information.
 	void pingAll();
 
+	/// Get the totals of traffic exchanged with peers since we started.
+	NetworkTraffic traffic() const { Guard l(x_traffic); return m_traffic; }
+
 	/// Get the port we're listening on currently.
 	unsigned short listenPort() const { return m_public.port(); }
 
@@ -108,13 +111,23 @@ public:
 	void registerPeer(std::shared_ptr<PeerSession> _s);
 
 private:
-	/// Session wants to pass us a block that we might not have.
+	/// Session @a _from wants to pass us a block that we might not have.
 	/// @returns true if we didn't have it.
-	bool noteBlock(h256 _hash, bytesConstRef _data);
+	bool noteBlock(h256 _hash, bytesConstRef _data, std::weak_ptr<PeerSession> const& _from);
 	/// Session has finished getting the chain of hashes.
 	void noteHaveChain(std::shared_ptr<PeerSession> const& _who);
 	/// Called when the session has provided us with a new peer we can connect to.
 	void noteNewPeers() {}
+	/// Session has received a packet of @a _bytes bytes, including framing.
+	void noteReceived(size_t _bytes) { Guard l(x_traffic); m_traffic.bytesIn += _bytes; m_traffic.packetsIn++; }
+	/// Session has finished sending a packet of @a _bytes bytes, including framing.
+	void noteSent(size_t _bytes) { Guard l(x_traffic); m_traffic.bytesOut += _bytes; m_traffic.packetsOut++; }
+	/// Session has interpreted a packet with @a _bytes bytes of (uncompressed) payload and framing.
+	void notePayloadReceived(size_t _bytes) { Guard l(x_traffic); m_traffic.payloadBytesIn += _bytes; }
+	/// Session has queued a packet with @a _bytes bytes of (uncompressed) payload and framing.
+	void notePayloadSent(size_t _bytes) { Guard l(x_traffic); m_traffic.payloadBytesOut += _bytes; }
+	/// Session with peer @a _id is going away; remember how it scored for when we next choose whom to connect to.
+	void notePeerScore(Public _id, int _score) { Guard l(x_peerScores); m_peerScores[_id] = _score; }
 
 	void seal(bytes& _b);
 	void populateAddresses();
@@ -158,8 +171,8 @@ private:
 	mutable std::map<Public, std::weak_ptr<PeerSession>> m_peers;	// mutable because we flush zombie entries (null-weakptrs) as regular maintenance from a const method.
 
 	mutable std::recursive_mutex m_incomingLock;
-	std::vector<bytes> m_incomingTransactions;
-	std::vector<bytes> m_incomingBlocks;
+	std::vector<std::pair<bytes, std::weak_ptr<PeerSession>>> m_incomingTransactions;	///< Transactions received, with the session that gave them to us.
+	std::vector<std::pair<bytes, std::weak_ptr<PeerSession>>> m_incomingBlocks;		///< Blocks received, with the session that gave them to us.
 	std::map<Public, std::pair<bi::tcp::endpoint, unsigned>> m_incomingPeers;
 	std::vector<Public> m_freePeers;
 
@@ -178,6 +191,12 @@ private:
 	std::vector<bi::address_v4> m_peerAddresses;
 
 	bool m_accepting = false;
+
+	mutable std::mutex x_peerScores;
+	std::map<Public, int> m_peerScores;	///< Score each peer we've had a session with had when the session ended.
+
+	mutable std::mutex x_traffic;
+	NetworkTraffic m_traffic;
 };
 
 }
@@ -22,6 +22,9 @@
 #include "PeerSession.h"
 
 #include <chrono>
+#if ETH_SNAPPY
+#include <snappy.h>
+#endif
 #include <libethential/Common.h>
 #include <libethcore/Exceptions.h>
 #include "BlockChain.h"
@@ -29,23 +32,30 @@
 using namespace std;
 using namespace eth;
 
-#define clogS(X) eth::LogOutputStream<X, true>(false) << "| " << std::setw(2) << m_socket.native_handle() << "] "
+#if ETH_SNAPPY
+static const bool c_haveCompression = true;
+#else
+static const bool c_haveCompression = false;
+#endif
+
+#define clogS(X) ETH_LOG_GUARD(X) eth::LogOutputStream<X, true>(false) << "| " << std::setw(2) << m_socket.native_handle() << "] "
 
 PeerSession::PeerSession(PeerServer* _s, bi::tcp::socket _socket, u256 _rNId, bi::address _peerAddress, unsigned short _peerPort):
 	m_server(_s),
 	m_socket(std::move(_socket)),
 	m_reqNetworkId(_rNId),
-	m_listenPort(_peerPort),
-	m_rating(0)
+	m_listenPort(_peerPort)
 {
 	m_disconnect = std::chrono::steady_clock::time_point::max();
 	m_connect = std::chrono::steady_clock::now();
-	m_info = PeerInfo({"?", _peerAddress.to_string(), m_listenPort, std::chrono::steady_clock::duration(0)});
+	m_info = PeerInfo({"?", _peerAddress.to_string(), m_listenPort, std::chrono::steady_clock::duration(0), PeerMetrics()});
 }
 
 PeerSession::~PeerSession()
 {
 	giveUpOnFetch();
+	if (m_id)
+		m_server->notePeerScore(m_id, rating());
 
 	// Read-chain finished for one reason or another.
 	try
@@ -86,8 +96,33 @@ bi::tcp::endpoint PeerSession::endpoint() const
 bool PeerSession::interpret(RLP const& _r)
 {
 	clogS(NetRight) << _r;
+	if (_r[0].toInt<unsigned>() != CompressedPacket)
+		m_server->notePayloadReceived(_r.actualSize() + 8);
 	switch (_r[0].toInt<unsigned>())
 	{
+	case CompressedPacket:
+	{
+		bytesConstRef in = _r[1].toBytesConstRef();
+		bytes payload;
+#if ETH_SNAPPY
+		size_t size;
+		if (snappy::GetUncompressedLength((char const*)in.data(), in.size(), &size) && size <= c_maxPacketSize)
+		{
+			payload.resize(size);
+			if (!snappy::RawUncompress((char const*)in.data(), in.size(), (char*)payload.data()))
+				payload.clear();
+		}
+#endif
+		RLP r(&payload);
+		if (payload.empty() || r.actualSize() != payload.size() || r[0].toInt<unsigned>() == CompressedPacket)
+		{
+			cwarn << "INVALID COMPRESSED PACKET RECEIVED";
+			disconnect(BadProtocol);
+			return false;
+		}
+		clogS(NetAllDetail) << "Compressed (" << dec << in.size() << " -> " << payload.size() << " bytes)";
+		return interpret(r);
+	}
 	case HelloPacket:
 	{
 		m_protocolVersion = _r[1].toInt<uint>();
@@ -115,7 +150,7 @@ bool PeerSession::interpret(RLP const& _r)
 			return false;
 		}
 		try
-			{ m_info = PeerInfo({clientVersion, m_socket.remote_endpoint().address().to_string(), m_listenPort, std::chrono::steady_clock::duration()}); }
+			{ m_info = PeerInfo({clientVersion, m_socket.remote_endpoint().address().to_string(), m_listenPort, std::chrono::steady_clock::duration(), PeerMetrics()}); }
 		catch (...)
 		{
 			disconnect(BadProtocol);
@@ -157,6 +192,7 @@ bool PeerSession::interpret(RLP const& _r)
 	}
 	case PongPacket:
 		m_info.lastPing = std::chrono::steady_clock::now() - m_ping;
+		noteLatency(m_info.lastPing);
         clogS(NetTriviaSummary) << "Latency: " << chrono::duration_cast<chrono::milliseconds>(m_info.lastPing).count() << " ms";
 		break;
 	case GetPeersPacket:
@@ -207,16 +243,20 @@ bool PeerSession::interpret(RLP const& _r)
 		}
 		break;
 	case TransactionsPacket:
+	{
 		if (m_server->m_mode == NodeMode::PeerServer)
 			break;
 		clogS(NetMessageSummary) << "Transactions (" << dec << (_r.itemCount() - 1) << " entries)";
-		m_rating += _r.itemCount() - 1;
+		vector<bytesConstRef> txs;
 		for (unsigned i = 1; i < _r.itemCount(); ++i)
 		{
-			m_server->m_incomingTransactions.push_back(_r[i].data().toBytes());
-			m_knownTransactions.insert(sha3(_r[i].data()));
+			m_server->m_incomingTransactions.push_back(make_pair(_r[i].data().toBytes(), shared_from_this()));
+			txs.push_back(_r[i].data());
 		}
+		for (auto const& h: sha3(txs))
+			m_knownTransactions.insert(h);
 		break;
+	}
 	case GetBlockHashesPacket:
 	{
 		if (m_server->m_mode == NodeMode::PeerServer)
@@ -250,7 +290,16 @@ bool PeerSession::interpret(RLP const& _r)
 			auto h = _r[i].toHash<h256>();
 			if (m_server->m_chain->details(h))
 			{
-				m_server->noteHaveChain(shared_from_this());
+				// Found the common ancestor. If they can, check their headers before believing their difficulty and fetching bodies.
+				if ((m_caps & c_headersCap) && m_neededBlocks.size())
+				{
+					m_lastHeader = BlockInfo(m_server->m_chain->block(h));
+					m_headersDifficulty = m_server->m_chain->details(h).totalDifficulty;
+					m_headersVerified = 0;
+					getHeaders();
+				}
+				else
+					m_server->noteHaveChain(shared_from_this());
 				return true;
 			}
 			else
@@ -289,6 +338,11 @@ bool PeerSession::interpret(RLP const& _r)
 		if (m_server->m_mode == NodeMode::PeerServer)
 			break;
 		clogS(NetMessageSummary) << "Blocks (" << dec << (_r.itemCount() - 1) << " entries)";
+		if (m_getBlocksSent != chrono::steady_clock::time_point())
+		{
+			noteLatency(chrono::steady_clock::now() - m_getBlocksSent);
+			m_getBlocksSent = chrono::steady_clock::time_point();
+		}
 
 		if (_r.itemCount() == 1)
 		{
@@ -297,23 +351,28 @@ bool PeerSession::interpret(RLP const& _r)
 			break;
 		}
 
+		vector<bytesConstRef> blocks;
+		for (unsigned i = 1; i < _r.itemCount(); ++i)
+			blocks.push_back(_r[i].data());
+		vector<h256> hashes = sha3(blocks);
 		unsigned used = 0;
 		for (unsigned i = 1; i < _r.itemCount(); ++i)
 		{
-			auto h = sha3(_r[i].data());
-			if (m_server->noteBlock(h, _r[i].data()))
+			auto h = hashes[i - 1];
+			if (m_server->noteBlock(h, _r[i].data(), shared_from_this()))
 				used++;
 			m_askedBlocks.erase(h);
 			m_knownBlocks.insert(h);
 		}
-		m_rating += used;
+		// Those we pass on are judged once they've been through the block queue.
+		m_metrics.duplicateBlocks += _r.itemCount() - 1 - used;
 		unsigned knownParents = 0;
 		unsigned unknownParents = 0;
 		if (g_logVerbosity >= NetMessageSummary::verbosity)
 		{
 			for (unsigned i = 1; i < _r.itemCount(); ++i)
 			{
-				auto h = sha3(_r[i].data());
+				auto h = hashes[i - 1];
 				BlockInfo bi(_r[i].data());
 				if (!m_server->m_chain->details(bi.parentHash) && !m_knownBlocks.count(bi.parentHash))
 				{
@@ -337,6 +396,33 @@ bool PeerSession::interpret(RLP const& _r)
 		m_requireTransactions = true;
 		break;
 	}
+	case GetBlockHeadersPacket:
+	{
+		if (m_server->m_mode == NodeMode::PeerServer)
+			break;
+		clogS(NetMessageSummary) << "GetBlockHeaders (" << dec << (_r.itemCount() - 1) << " entries)";
+		bytes rlp;
+		unsigned n = 0;
+		for (unsigned i = 1; i < _r.itemCount() && i <= c_maxHeaders; ++i)
+		{
+			auto b = m_server->m_chain->block(_r[i].toHash<h256>());
+			if (b.empty())
+				break;
+			rlp += RLP(b)[0].data().toBytes();
+			++n;
+		}
+		RLPStream s;
+		sealAndSend(prep(s).appendList(n + 1).append(BlockHeadersPacket).appendRaw(rlp, n));
+		break;
+	}
+	case BlockHeadersPacket:
+	{
+		if (m_server->m_mode == NodeMode::PeerServer)
+			break;
+		clogS(NetMessageSummary) << "BlockHeaders (" << dec << (_r.itemCount() - 1) << " entries)";
+		interpretHeaders(_r);
+		break;
+	}
 	default:
 		break;
 	}
@@ -356,11 +442,72 @@ void PeerSession::ensureGettingChain()
 		for (auto i: m_askedBlocks)
 			s << i;
 		sealAndSend(s);
+		m_getBlocksSent = chrono::steady_clock::now();
 	}
 	else
 		clogS(NetMessageSummary) << "No blocks left to get.";
 }
 
+void PeerSession::getHeaders()
+{
+	m_headersAsked = min<unsigned>(c_maxHeadersAsk, m_neededBlocks.size() - m_headersVerified);
+	RLPStream s;
+	prep(s).appendList(m_headersAsked + 1) << GetBlockHeadersPacket;
+	// m_neededBlocks runs from latest to earliest; we want them the other way around.
+	for (unsigned i = 0; i < m_headersAsked; ++i)
+		s << m_neededBlocks[m_neededBlocks.size() - 1 - m_headersVerified - i];
+	sealAndSend(s);
+}
+
+void PeerSession::interpretHeaders(RLP const& _r)
+{
+	if (!m_headersAsked)
+		return;	// Not asked for; ignore.
+	if (_r.itemCount() == 1 || _r.itemCount() - 1 > m_headersAsked)
+	{
+		// They can't back up the chain they told us about.
+		clogS(NetNote) << "Peer didn't give us the headers of its chain; ignoring it.";
+		m_headersAsked = 0;
+		m_neededBlocks.clear();
+		noteInvalid();
+		return;
+	}
+
+	try
+	{
+		for (unsigned i = 1; i < _r.itemCount(); ++i)
+		{
+			// We can't hash a header into its block's hash, so take theirs for now; if it's a lie, the body won't match when it comes.
+			BlockInfo bi;
+			bi.populateFromHeader(_r[i]);
+			bi.hash = m_neededBlocks[m_neededBlocks.size() - 1 - m_headersVerified];
+			bi.verifyParent(m_lastHeader);
+			m_headersDifficulty += bi.difficulty;
+			m_lastHeader = bi;
+			++m_headersVerified;
+		}
+	}
+	catch (Exception const& _e)
+	{
+		clogS(NetWarn) << "Invalid header from peer (" << _e.description() << "); ignoring its chain.";
+		m_headersAsked = 0;
+		m_neededBlocks.clear();
+		noteInvalid();
+		return;
+	}
+	m_headersAsked = 0;
+
+	if (m_headersVerified < m_neededBlocks.size())
+		getHeaders();
+	else
+	{
+		// The whole chain checks out. Its difficulty is now something we've verified rather than their say-so.
+		clogS(NetNote) << "Validated " << m_headersVerified << " headers; total difficulty " << m_headersDifficulty;
+		m_totalDifficulty = m_headersDifficulty;
+		m_server->noteHaveChain(shared_from_this());
+	}
+}
+
 void PeerSession::ping()
 {
 	RLPStream s;
@@ -368,6 +515,29 @@ void PeerSession::ping()
 	m_ping = std::chrono::steady_clock::now();
 }
 
+void PeerSession::noteLatency(std::chrono::steady_clock::duration _d)
+{
+	// Exponential moving average; recent measurements count for a quarter.
+	m_metrics.latency = m_metrics.latency.count() ? (m_metrics.latency * 3 + _d) / 4 : _d;
+}
+
+void PeerSession::noteInvalid()
+{
+	if (++m_metrics.invalid > c_maxInvalid)
+		disconnect(BadProtocol);
+}
+
+int PeerSession::rating() const
+{
+	// Reward what they gave us that we didn't already have; charge for junk, repeats, bandwidth and slowness.
+	auto const& m = m_metrics;
+	int64_t ret = (int64_t)m.usefulBlocks * 20 + (int64_t)m.usefulTransactions * 2;
+	ret -= (int64_t)m.duplicateBlocks * 2 + m.duplicateTransactions / 4 + (int64_t)m.invalid * 50;
+	ret -= (m.bytesIn + m.bytesOut) / 65536;
+	ret -= chrono::duration_cast<chrono::milliseconds>(m.latency).count() / 100;
+	return (int)max<int64_t>(min<int64_t>(ret, numeric_limits<int>::max()), numeric_limits<int>::min());
+}
+
 void PeerSession::getPeers()
 {
 	RLPStream s;
@@ -428,12 +598,42 @@ void PeerSession::send(bytesConstRef _msg)
 	writeImpl(buffer);
 }
 
+void PeerSession::compress(bytes& io_buffer)
+{
+#if ETH_SNAPPY
+	// Only the bulky packets are worth it, and only if they can understand it.
+	if (!(m_caps & c_compressionCap) || io_buffer.size() < c_compressionThreshold + 8)
+		return;
+	bytesConstRef payload = bytesConstRef(&io_buffer).cropped(8);
+	unsigned type = RLP(payload)[0].toInt<unsigned>();
+	if (type != BlocksPacket && type != TransactionsPacket && type != BlockHeadersPacket)
+		return;
+
+	bytes c(snappy::MaxCompressedLength(payload.size()));
+	size_t cSize;
+	snappy::RawCompress((char const*)payload.data(), payload.size(), (char*)c.data(), &cSize);
+	c.resize(cSize);
+
+	RLPStream s;
+	prep(s).appendList(2) << CompressedPacket << c;
+	if (s.out().size() >= io_buffer.size())
+		return;
+	s.swapOut(io_buffer);
+	m_server->seal(io_buffer);
+#else
+	(void)io_buffer;
+#endif
+}
+
 void PeerSession::writeImpl(bytes& _buffer)
 {
 //	cerr << (void*)this << " writeImpl" << endl;
 	if (!m_socket.is_open())
 		return;
 
+	m_server->notePayloadSent(_buffer.size());
+	compress(_buffer);
+
 	lock_guard<recursive_mutex> l(m_writeLock);
 	m_writeQueue.push_back(_buffer);
 	if (m_writeQueue.size() == 1)
@@ -449,7 +649,7 @@ void PeerSession::write()
 	
 	const bytes& bytes = m_writeQueue[0];
 	auto self(shared_from_this());
-	ba::async_write(m_socket, ba::buffer(bytes), [this, self](boost::system::error_code ec, std::size_t /*length*/)
+	ba::async_write(m_socket, ba::buffer(bytes), [this, self](boost::system::error_code ec, std::size_t length)
 	{
 //		cerr << (void*)this << " write.callback" << endl;
 
@@ -461,6 +661,8 @@ void PeerSession::write()
 		}
 		else
 		{
+			m_server->noteSent(length);
+			m_metrics.bytesOut += length;
 			m_writeQueue.pop_front();
 			write();
 		}
@@ -505,7 +707,7 @@ void PeerSession::start()
 					<< (uint)PeerServer::protocolVersion()
 					<< m_server->networkId()
 					<< m_server->m_clientVersion
-					<< (m_server->m_mode == NodeMode::Full ? 0x07 : m_server->m_mode == NodeMode::PeerServer ? 0x01 : 0)
+					<< ((m_server->m_mode == NodeMode::Full ? 0x07 | c_headersCap : m_server->m_mode == NodeMode::PeerServer ? 0x01 : 0) | (c_haveCompression ? c_compressionCap : 0))
 					<< m_server->m_public.port()
 					<< m_server->m_key.pub()
 					<< m_server->m_chain->details().totalDifficulty
@@ -540,9 +742,10 @@ void PeerSession::doRead()
 	// ignore packets received while waiting to disconnect
 	if (chrono::steady_clock::now() - m_disconnect > chrono::seconds(0))
 		return;
-	
+
+	prepareIncoming();
 	auto self(shared_from_this());
-	m_socket.async_read_some(boost::asio::buffer(m_data), [this,self](boost::system::error_code ec, std::size_t length)
+	m_socket.async_read_some(boost::asio::buffer(m_incoming.data() + m_incomingEnd, m_incoming.size() - m_incomingEnd), [this,self](boost::system::error_code ec, std::size_t length)
 	{
 		// If error is end of file, ignore
 		if (ec && ec.category() != boost::asio::error::get_misc_category() && ec.value() != boost::asio::error::eof)
@@ -559,47 +762,9 @@ void PeerSession::doRead()
 		{
 			try
 			{
-				m_incoming.resize(m_incoming.size() + length);
-				memcpy(m_incoming.data() + m_incoming.size() - length, m_data.data(), length);
-				while (m_incoming.size() > 8)
-				{
-					if (m_incoming[0] != 0x22 || m_incoming[1] != 0x40 || m_incoming[2] != 0x08 || m_incoming[3] != 0x91)
-					{
-						cwarn << "INVALID SYNCHRONISATION TOKEN; expected = 22400891; received = " << toHex(bytesConstRef(m_incoming.data(), 4));
-						disconnect(BadProtocol);
-						return;
-					}
-					else
-					{
-						uint32_t len = fromBigEndian<uint32_t>(bytesConstRef(m_incoming.data() + 4, 4));
-						uint32_t tlen = len + 8;
-						if (m_incoming.size() < tlen)
-							break;
-
-						// enough has come in.
-						auto data = bytesConstRef(m_incoming.data(), tlen);
-						if (!checkPacket(data))
-						{
-							cerr << "Received " << len << ": " << toHex(bytesConstRef(m_incoming.data() + 8, len)) << endl;
-							cwarn << "INVALID MESSAGE RECEIVED";
-							disconnect(BadProtocol);
-							return;
-						}
-						else
-						{
-							RLP r(data.cropped(8));
-							if (!interpret(r))
-							{
-								// error
-								dropped();
-								return;
-							}
-						}
-						memmove(m_incoming.data(), m_incoming.data() + tlen, m_incoming.size() - tlen);
-						m_incoming.resize(m_incoming.size() - tlen);
-					}
-				}
-				doRead();
+				m_incomingEnd += length;
+				if (interpretIncoming())
+					doRead();
 			}
 			catch (Exception const& _e)
 			{
@@ -614,3 +779,84 @@ void PeerSession::doRead()
 		}
 	});
 }
+
+void PeerSession::prepareIncoming()
+{
+	size_t pending = m_incomingEnd - m_incomingBegin;
+
+	// Once everything is interpreted, start again at the front (and let go of any slab grown for a large packet).
+	if (!pending)
+	{
+		m_incomingBegin = m_incomingEnd = 0;
+		if (m_incoming.size() > c_readChunkSize * 4)
+			bytes().swap(m_incoming);
+	}
+
+	// If we know how big the partial packet is, make room for all of it so it arrives without further shuffling.
+	size_t needed = c_readChunkSize;
+	if (pending >= 8)
+	{
+		size_t total = fromBigEndian<uint32_t>(bytesConstRef(m_incoming.data() + m_incomingBegin + 4, 4)) + 8;
+		if (total > pending)
+			needed = max<size_t>(needed, total - pending);
+	}
+
+	if (m_incoming.size() - m_incomingEnd < needed)
+	{
+		// Move the partial packet to the front; this happens at most once per partial packet, rather than once per packet.
+		if (m_incomingBegin)
+		{
+			memmove(m_incoming.data(), m_incoming.data() + m_incomingBegin, pending);
+			m_incomingBegin = 0;
+			m_incomingEnd = pending;
+		}
+		if (m_incoming.size() - m_incomingEnd < needed)
+			m_incoming.resize(m_incomingEnd + needed);
+	}
+}
+
+bool PeerSession::interpretIncoming()
+{
+	while (m_incomingEnd - m_incomingBegin >= 8)
+	{
+		bytesConstRef in(m_incoming.data() + m_incomingBegin, m_incomingEnd - m_incomingBegin);
+		if (in[0] != 0x22 || in[1] != 0x40 || in[2] != 0x08 || in[3] != 0x91)
+		{
+			cwarn << "INVALID SYNCHRONISATION TOKEN; expected = 22400891; received = " << toHex(in.cropped(0, 4));
+			disconnect(BadProtocol);
+			return false;
+		}
+
+		uint32_t len = fromBigEndian<uint32_t>(in.cropped(4, 4));
+		if (len > c_maxPacketSize)
+		{
+			cwarn << "PACKET TOO LARGE; maximum = " << c_maxPacketSize << "; announced = " << len;
+			disconnect(BadProtocol);
+			return false;
+		}
+		if (in.size() < len + 8)
+			break;
+
+		// enough has come in.
+		RLP r(in.cropped(8, len));
+		if (r.actualSize() != len)
+		{
+			cerr << "Received " << len << ": " << toHex(in.cropped(8, len)) << endl;
+			cwarn << "INVALID MESSAGE RECEIVED";
+			disconnect(BadProtocol);
+			return false;
+		}
+
+		// The packet stays where it is in the slab until it's interpreted; we only move our read position on.
+		m_incomingBegin += len + 8;
+		m_server->noteReceived(len + 8);
+		m_metrics.bytesIn += len + 8;
+		if (!interpret(r))
+		{
+			// error
+			dropped();
+			return false;
+		}
+	}
+	return true;
+}
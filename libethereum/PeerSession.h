@@ -28,6 +28,7 @@
 #include <utility>
 #include <libethential/RLP.h>
 #include <libethcore/CommonEth.h>
+#include <libethcore/BlockInfo.h>
 #include "PeerNetwork.h"
 
 namespace eth
@@ -54,6 +55,11 @@ public:
 
 	bi::tcp::endpoint endpoint() const;	///< for other peers to connect to.
 
+	/// @returns the peer's score; the higher the more it's worth to us. See PeerMetrics.
+	int rating() const;
+	/// @returns what the peer has cost and given us so far, score included.
+	PeerMetrics metrics() const { PeerMetrics ret = m_metrics; ret.score = rating(); return ret; }
+
 private:
 	void startInitialSync();
 	void getPeers();
@@ -61,10 +67,27 @@ private:
 	/// Ensure that we are waiting for a bunch of blocks from our peer.
 	void ensureGettingChain();
 
+	/// Header-first sync: ask for the next batch of headers of m_neededBlocks, earliest first, to validate before we commit to the chain.
+	void getHeaders();
+	/// Header-first sync: validate a batch of headers we asked for, moving on to the next or, once done, to downloading bodies.
+	void interpretHeaders(RLP const& _r);
+
 	void giveUpOnFetch();
 
+	/// Fold a round-trip time measurement into the peer's smoothed latency.
+	void noteLatency(std::chrono::steady_clock::duration _d);
+	/// Note the peer sent us something bad. Disconnects once it has done so too often.
+	void noteInvalid();
+
 	void dropped();
 	void doRead();
+
+	/// Make sure there is room at the tail of m_incoming for the next socket read, compacting or growing the slab as needed.
+	void prepareIncoming();
+	/// Interpret, in place, each complete packet buffered in m_incoming.
+	/// @returns false if the session was disconnected or dropped and reading should stop.
+	bool interpretIncoming();
+
 	void doWrite(std::size_t length);
 	bool interpret(RLP const& _r);
 
@@ -75,6 +98,8 @@ private:
 	void sealAndSend(RLPStream& _s);
 	void sendDestroy(bytes& _msg);
 	void send(bytesConstRef _msg);
+	/// Replace the sealed packet @a io_buffer with its compressed form, if the peer takes them and it's worth it.
+	void compress(bytes& io_buffer);
 	void writeImpl(bytes& _buffer);
 	void write();
 	PeerServer* m_server;
@@ -83,16 +108,17 @@ private:
 	std::deque<bytes> m_writeQueue;
 
 	bi::tcp::socket m_socket;
-	std::array<byte, 65536> m_data;
 	PeerInfo m_info;
 	Public m_id;
 
-	bytes m_incoming;
+	bytes m_incoming;						///< Slab into which we read; bytes in [m_incomingBegin, m_incomingEnd) are received but not yet interpreted.
+	size_t m_incomingBegin = 0;				///< Offset of the first uninterpreted byte in m_incoming.
+	size_t m_incomingEnd = 0;				///< Offset just past the last received byte in m_incoming.
 	uint m_protocolVersion;
 	u256 m_networkId;
 	u256 m_reqNetworkId;
 	unsigned short m_listenPort;			///< Port that the remote client is listening on for connections. Useful for giving to peers.
-	uint m_caps;
+	uint m_caps = 0;
 
 	h256 m_latestHash;						///< Peer's latest block's hash.
 	u256 m_totalDifficulty;					///< Peer's latest block's total difficulty.
@@ -100,11 +126,17 @@ private:
 
 	h256Set m_askedBlocks;					///< The blocks for which we sent the last GetBlocks for but haven't received a corresponding Blocks.
 
+	unsigned m_headersVerified = 0;			///< How many of m_neededBlocks (from the back) have had their header validated.
+	unsigned m_headersAsked = 0;			///< How many headers our outstanding GetBlockHeaders asked for; zero if none.
+	BlockInfo m_lastHeader;					///< The latest header validated; the common ancestor to begin with.
+	u256 m_headersDifficulty;				///< Total difficulty of the chain up to and including m_lastHeader.
+
 	std::chrono::steady_clock::time_point m_ping;
+	std::chrono::steady_clock::time_point m_getBlocksSent;	///< When we sent the GetBlocks that is yet to be answered; default if none.
 	std::chrono::steady_clock::time_point m_connect;
 	std::chrono::steady_clock::time_point m_disconnect;
 
-	uint m_rating;
+	PeerMetrics m_metrics;
 	bool m_requireTransactions;
 
 	std::set<h256> m_knownBlocks;
@@ -24,6 +24,8 @@
 #include <boost/filesystem.hpp>
 #include <time.h>
 #include <random>
+#include <atomic>
+#include <thread>
 #include <secp256k1/secp256k1.h>
 #include <libevmface/Instruction.h>
 #include <libethcore/Exceptions.h>
@@ -39,6 +41,37 @@ using namespace eth;
 
 static const u256 c_blockReward = 1500 * finney;
 
+static std::atomic<unsigned> s_reexecutions(0);
+
+unsigned State::reexecutions()
+{
+	return s_reexecutions;
+}
+
+bool StateAccess::conflictsWith(StateAccess const& _earlier) const
+{
+	for (auto const& a: reads)
+		if (_earlier.writes.count(a))
+			return true;
+	for (auto const& s: slotReads)
+		if (_earlier.resets.count(s.first) || _earlier.slotWrites.count(s))
+			return true;
+	for (auto const& a: storageReads)
+	{
+		auto it = _earlier.slotWrites.lower_bound(make_pair(a, u256()));
+		if (_earlier.resets.count(a) || (it != _earlier.slotWrites.end() && it->first == a))
+			return true;
+	}
+	return false;
+}
+
+void StateAccess::absorbWrites(StateAccess const& _later)
+{
+	writes.insert(_later.writes.begin(), _later.writes.end());
+	slotWrites.insert(_later.slotWrites.begin(), _later.slotWrites.end());
+	resets.insert(_later.resets.begin(), _later.resets.end());
+}
+
 OverlayDB State::openDB(std::string _path, bool _killExisting)
 {
 	if (_path.empty())
@@ -118,6 +151,9 @@ State::State(State const& _s):
 	m_ourAddress(_s.m_ourAddress),
 	m_blockReward(_s.m_blockReward)
 {
+	// m_access is left null: the record belongs to whoever's executing on _s, and a copy (the paranoid pre-execution
+	// snapshot, or a parallel enactment's per-worker base) mustn't add its own reads and writes to it, least of all
+	// from another thread. A copy that should record is given its own StateAccess, as speculate() does.
 	paranoia("after state cloning (copy cons).", true);
 }
 
@@ -148,6 +184,7 @@ State& State::operator=(State const& _s)
 	m_currentBlock = _s.m_currentBlock;
 	m_ourAddress = _s.m_ourAddress;
 	m_blockReward = _s.m_blockReward;
+	// m_access stays as it was, for the same reason the copy constructor doesn't take it.
 	paranoia("after state cloning (assignment op)", true);
 	return *this;
 }
@@ -270,6 +307,8 @@ StateDiff State::diff(State const& _c) const
 
 void State::ensureCached(Address _a, bool _requireCode, bool _forceCreate) const
 {
+	if (m_access)
+		m_access->reads.insert(_a);
 	ensureCached(m_cache, _a, _requireCode, _forceCreate);
 }
 
@@ -280,14 +319,21 @@ void State::ensureCached(std::map<Address, AddressState>& _cache, Address _a, bo
 	{
 		// populate basic info.
 		string stateBack = m_state.at(_a);
+		bool recording = m_access && &_cache == &m_cache;
 		if (stateBack.empty() && !_forceCreate)
+		{
+			if (recording)
+				m_access->loaded.insert(make_pair(_a, AddressState()));
 			return;
+		}
 		RLP state(stateBack);
 		AddressState s;
 		if (state.isNull())
 			s = AddressState(0, 0, h256(), EmptySHA3);
 		else
 			s = AddressState(state[0].toInt<u256>(), state[1].toInt<u256>(), state[2].toHash<h256>(), state[3].toHash<h256>());
+		if (recording)
+			m_access->loaded.insert(make_pair(_a, state.isNull() ? AddressState() : s));
 		bool ok;
 		tie(it, ok) = _cache.insert(make_pair(_a, s));
 	}
@@ -379,7 +425,7 @@ bool State::sync(BlockChain const& _bc, h256 _block, BlockInfo const& _bi)
 	return ret;
 }
 
-u256 State::enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc)
+u256 State::enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc, unsigned _threads)
 {
 	// Check family:
 	BlockInfo biParent(_bc.block(_bi.parentHash));
@@ -390,7 +436,7 @@ u256 State::enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const
 	sync(_bc, _bi.parentHash);
 	resetCurrent();
 	m_previousBlock = biParent;
-	return enact(_block, biGrandParent);
+	return enact(_block, biGrandParent, true, _threads);
 }
 
 map<Address, u256> State::addresses() const
@@ -430,76 +476,141 @@ void State::resetCurrent()
 bool State::cull(TransactionQueue& _tq) const
 {
 	bool ret = false;
-	auto ts = _tq.transactions();
-	for (auto const& i: ts)
-	{
-		if (!m_transactionSet.count(i.first))
+	for (auto const& i: _tq.ordered())
+		if (!m_transactionSet.count(i->hash) && i->transaction.nonce <= transactionsFrom(i->sender))
+		{
+			_tq.drop(i->hash);
+			ret = true;
+		}
+	return ret;
+}
+
+h256s State::sync(TransactionQueue& _tq, bool* o_transactionQueueChanged)
+{
+	// TRANSACTIONS
+	// One pass does it: the queue gives them to us such that each is preceded by any of its sender's of lower nonce.
+	h256s ret;
+	set<Address> stalled;
+	for (auto const& i: _tq.ordered())
+		if (!m_transactionSet.count(i->hash) && !stalled.count(i->sender))
 		{
+			// Check the nonce before going to the trouble of executing it.
+			u256 required = transactionsFrom(i->sender);
+			if (i->transaction.nonce > required)
+			{
+				// It (and all that follow it) will have to wait until we get the transactions in between.
+				stalled.insert(i->sender);
+				continue;
+			}
+			if (i->transaction.nonce < required)
+			{
+				// too old
+				_tq.drop(i->hash);
+				if (o_transactionQueueChanged)
+					*o_transactionQueueChanged = true;
+				continue;
+			}
+
+			// don't have it yet! Execute it now, noting what it touches so we can carry it over to a new head.
+			auto access = make_shared<StateAccess>();
 			try
 			{
-				Transaction t(i.second);
-				if (t.nonce <= transactionsFrom(t.sender()))
-				{
-					_tq.drop(i.first);
-					ret = true;
-				}
+				uncommitToMine();
+				m_access = access.get();
+				execute(i->transaction, i->hash);
+				m_access = nullptr;
+				m_transactions.back().access = access;
+				ret.push_back(m_transactions.back().changes.bloom());
 			}
-			catch (...)
+			catch (std::exception const&)
 			{
-				_tq.drop(i.first);
-				ret = true;
+				m_access = nullptr;
+				// Something went wrong - drop it, and as the sender's nonce hasn't moved, hold the rest of theirs back.
+				_tq.drop(i->hash);
+				stalled.insert(i->sender);
+				if (o_transactionQueueChanged)
+					*o_transactionQueueChanged = true;
 			}
 		}
-	}
 	return ret;
 }
 
-h256s State::sync(TransactionQueue& _tq, bool* o_transactionQueueChanged)
+h256s State::rebase(State const& _old)
 {
-	// TRANSACTIONS
 	h256s ret;
-	auto ts = _tq.transactions();
+	if (_old.m_ourAddress != m_ourAddress || m_transactions.size())
+		return ret;
+	for (auto const& r: _old.m_transactions)
+		if (!r.access)
+			return ret;
+	uncommitToMine();
 
-	for (int goodTxs = 1; goodTxs;)
+	// Before we write anything, find which of the accounts they read differ between the old head's state and ours.
+	// Whatever does, we treat as written wholesale by the blocks in between.
+	StateAccess written;
 	{
-		goodTxs = 0;
-		for (auto const& i: ts)
-			if (!m_transactionSet.count(i.first))
+		OverlayDB oldDB = _old.m_db;
+		TrieDB<Address, OverlayDB> oldState(&oldDB, _old.m_previousBlock.stateRoot);
+		set<Address> checked;
+		auto check = [&](Address _a)
+		{
+			if (checked.insert(_a).second && oldState.at(_a) != m_state.at(_a))
 			{
-				// don't have it yet! Execute it now.
-				try
-				{
-					uncommitToMine();
-					execute(i.second);
-					ret.push_back(m_transactions.back().changes.bloom());
-					_tq.noteGood(i);
-					++goodTxs;
-				}
-				catch (InvalidNonce const& in)
-				{
-					if (in.required > in.candidate)
-					{
-						// too old
-						_tq.drop(i.first);
-						if (o_transactionQueueChanged)
-							*o_transactionQueueChanged = true;
-					}
-					else
-						_tq.setFuture(i);
-				}
-				catch (std::exception const&)
-				{
-					// Something else went wrong - drop it.
-					_tq.drop(i.first);
-					if (o_transactionQueueChanged)
-						*o_transactionQueueChanged = true;
-				}
+				written.writes.insert(_a);
+				written.resets.insert(_a);
 			}
+		};
+		for (auto const& r: _old.m_transactions)
+		{
+			for (auto const& a: r.access->reads)
+				check(a);
+			for (auto const& s: r.access->slotReads)
+				check(s.first);
+			for (auto const& a: r.access->storageReads)
+				check(a);
+		}
+	}
+
+	u256 oldGasUsed = 0;
+	for (auto const& r: _old.m_transactions)
+	{
+		u256 txGasUsed = r.gasUsed - oldGasUsed;
+		oldGasUsed = r.gasUsed;
+		h256 hash = r.transaction.sha3();
+		if (!r.access->ranCode && !r.access->conflictsWith(written) && gasUsed() + r.transaction.gas <= m_currentBlock.gasLimit)
+		{
+			// Nothing it depends on has changed, so it'd do just what it did before.
+			u256 startGasUsed = gasUsed();
+			applyOutcome(*r.access);
+			commit();
+			m_transactions.push_back(TransactionReceipt(r.transaction, rootHash(), startGasUsed + txGasUsed, r.changes));
+			m_transactions.back().access = r.access;
+			m_transactionSet.insert(hash);
+			ret.push_back(r.changes.bloom());
+			continue;
+		}
+
+		// Whatever it wrote before may now be different, as may what it writes this time.
+		auto access = make_shared<StateAccess>();
+		m_access = access.get();
+		try
+		{
+			execute(r.transaction, hash);
+			m_transactions.back().access = access;
+			ret.push_back(m_transactions.back().changes.bloom());
+		}
+		catch (std::exception const&)
+		{
+			// No longer valid here; the queue will drop it next sync.
+		}
+		m_access = nullptr;
+		written.absorbWrites(*r.access);
+		written.absorbWrites(*access);
 	}
 	return ret;
 }
 
-u256 State::enact(bytesConstRef _block, BlockInfo const& _grandParent, bool _checkNonce)
+u256 State::enact(bytesConstRef _block, BlockInfo const& _grandParent, bool _checkNonce, unsigned _threads)
 {
 	// m_currentBlock is assumed to be prepopulated and reset.
 
@@ -520,33 +631,24 @@ u256 State::enact(bytesConstRef _block, BlockInfo const& _grandParent, bool _che
 //	cnote << "playback begins:" << m_state.root();
 //	cnote << m_state;
 
-	MemoryDB tm;
-	GenericTrieDB<MemoryDB> transactionManifest(&tm);
-	transactionManifest.init();
+	vector<bytes> transactionManifest;
 
 	// All ok with the block generally. Play back the transactions now...
-	unsigned i = 0;
-	for (auto const& tr: RLP(_block)[1])
-	{
-//		cnote << m_state.root() << m_state;
-//		cnote << *this;
-		execute(tr[0].data());
-		if (tr[1].toHash<h256>() != m_state.root())
+	RLP txs = RLP(_block)[1];
+	if (_threads > 1 && txs.itemCount() > 1)
+		enactParallel(txs, _threads);
+	else
+		for (auto const& tr: txs)
 		{
-			// Invalid state root
-			cnote << m_state.root() << "\n" << m_state;
-			cnote << *this;
-			cnote << "INVALID: " << tr[1].toHash<h256>();
-			throw InvalidTransactionStateRoot();
+//			cnote << m_state.root() << m_state;
+//			cnote << *this;
+			execute(tr[0].data());
+			checkReceipt(tr);
 		}
-		if (tr[2].toInt<u256>() != gasUsed())
-			throw InvalidTransactionGasUsed();
-		bytes k = rlp(i);
-		transactionManifest.insert(&k, tr.data());
-		++i;
-	}
+	for (auto const& tr: txs)
+		transactionManifest.push_back(tr.data().toBytes());
 
-	if (m_currentBlock.transactionsRoot && transactionManifest.root() != m_currentBlock.transactionsRoot)
+	if (m_currentBlock.transactionsRoot && orderedTrieRoot(transactionManifest) != m_currentBlock.transactionsRoot)
 	{
 		cwarn << "Bad transactions state root!";
 		throw InvalidTransactionStateRoot();
@@ -595,6 +697,188 @@ u256 State::enact(bytesConstRef _block, BlockInfo const& _grandParent, bool _che
 	return tdIncrease;
 }
 
+void State::checkReceipt(RLP const& _receipt) const
+{
+	if (_receipt[1].toHash<h256>() != m_state.root())
+	{
+		// Invalid state root
+		cnote << m_state.root() << "\n" << m_state;
+		cnote << *this;
+		cnote << "INVALID: " << _receipt[1].toHash<h256>();
+		throw InvalidTransactionStateRoot();
+	}
+	if (_receipt[2].toInt<u256>() != gasUsed())
+		throw InvalidTransactionGasUsed();
+}
+
+namespace
+{
+
+/// A transaction executed ahead of its turn, against the state at the start of the block.
+struct Speculation
+{
+	bytesConstRef rlp;
+	h256 hash;
+	Transaction transaction;
+	bool decoded = false;
+	bool ok = false;				///< False if execution threw; we don't know what it would have touched.
+	StateAccess access;
+	Manifest changes;
+	u256 gasUsed;
+};
+
+}
+
+void State::enactParallel(RLP const& _transactions, unsigned _threads)
+{
+	vector<Speculation> specs(_transactions.itemCount());
+	{
+		unsigned i = 0;
+		for (auto const& tr: _transactions)
+			specs[i++].rlp = tr[0].data();
+	}
+
+	// secp256k1 builds its tables lazily, and not thread-safely.
+	secp256k1_start();
+
+	// Each thread gets its own copy of the pre-block state to run transactions against.
+	commit();
+	vector<State> snapshots(min<size_t>(_threads, specs.size()), *this);
+	atomic<unsigned> next(0);
+	vector<thread> workers;
+	for (unsigned t = 0; t < snapshots.size(); ++t)
+		workers.push_back(thread([&, t]()
+		{
+			State& snapshot = snapshots[t];
+			for (unsigned i; (i = next++) < specs.size();)
+			{
+				Speculation& sp = specs[i];
+				sp.hash = sha3(sp.rlp);
+				try
+				{
+					sp.transaction = Transaction(sp.rlp);
+					sp.decoded = true;
+				}
+				catch (...)
+				{
+					continue;
+				}
+				sp.ok = snapshot.speculate(sp.transaction, sp.access, sp.changes, sp.gasUsed);
+			}
+		}));
+	for (auto& w: workers)
+		w.join();
+
+	// Commit in order. A transaction is good as it stands unless it read something an earlier one wrote; if it did,
+	// it's executed again here, on top of everything before it.
+	StateAccess written;
+	unsigned i = 0;
+	for (auto const& tr: _transactions)
+	{
+		Speculation& sp = specs[i++];
+		if (sp.ok && !sp.access.conflictsWith(written))
+		{
+			u256 startGasUsed = gasUsed();
+			applyOutcome(sp.access);
+			commit();
+			m_transactions.push_back(TransactionReceipt(sp.transaction, rootHash(), startGasUsed + sp.gasUsed, sp.changes));
+			m_transactionSet.insert(sp.hash);
+			written.absorbWrites(sp.access);
+		}
+		else
+		{
+			++s_reexecutions;
+			StateAccess access;
+			m_access = &access;
+			try
+			{
+				if (sp.decoded)
+					execute(sp.transaction, sp.hash);
+				else
+					execute(sp.rlp);
+			}
+			catch (...)
+			{
+				m_access = nullptr;
+				throw;
+			}
+			m_access = nullptr;
+			written.absorbWrites(access);
+		}
+		checkReceipt(tr);
+	}
+}
+
+bool State::speculate(Transaction const& _t, StateAccess& o_access, Manifest& o_ms, u256& o_gasUsed)
+{
+	m_cache.clear();
+	m_access = &o_access;
+	try
+	{
+		Executive e(*this, &o_ms);
+		e.setup(_t);
+		e.go();
+		e.finalize();
+		o_gasUsed = e.gasUsed();
+		noteOutcome(o_access);
+	}
+	catch (...)
+	{
+		// Most likely the transaction depends on one before it; either way it'll be executed again in turn.
+		m_access = nullptr;
+		return false;
+	}
+	m_access = nullptr;
+	return true;
+}
+
+void State::noteOutcome(StateAccess& io_access) const
+{
+	for (auto const& i: m_cache)
+	{
+		auto l = io_access.loaded.find(i.first);
+		bool existed = l != io_access.loaded.end() && l->second.isAlive();
+		if (!i.second.isAlive() || i.second.isFreshCode())
+		{
+			io_access.resets.insert(i.first);
+			io_access.writes.insert(i.first);
+		}
+		else if (!existed || i.second.nonce() != l->second.nonce() || i.second.balance() != l->second.balance())
+			io_access.writes.insert(i.first);
+	}
+	io_access.result = m_cache;
+}
+
+void State::applyOutcome(StateAccess const& _access)
+{
+	for (auto const& i: _access.result)
+		if (_access.resets.count(i.first))
+			m_cache[i.first] = i.second;
+		else if (_access.writes.count(i.first))
+		{
+			auto l = _access.loaded.find(i.first);
+			AddressState base = l == _access.loaded.end() ? AddressState() : l->second;
+			ensureCached(m_cache, i.first, false, true);
+			AddressState& s = m_cache[i.first];
+			s.addBalance((bigint)i.second.balance() - base.balance());
+			s.nonce() += i.second.nonce() - base.nonce();
+		}
+
+	for (auto const& w: _access.slotWrites)
+	{
+		auto r = _access.result.find(w.first);
+		if (_access.resets.count(w.first) || r == _access.result.end())
+			continue;
+		auto v = r->second.storage().find(w.second);
+		if (v == r->second.storage().end())
+			continue;
+		ensureCached(m_cache, w.first, false, false);
+		auto it = m_cache.find(w.first);
+		if (it != m_cache.end())
+			it->second.setStorage(w.second, v->second);
+	}
+}
+
 void State::cleanup(bool _fullCommit)
 {
 	if (_fullCommit)
@@ -710,27 +994,23 @@ void State::commitToMine(BlockChain const& _bc)
 	else
 		uncles.appendList(0);
 
-	MemoryDB tm;
-	GenericTrieDB<MemoryDB> transactionReceipts(&tm);
-	transactionReceipts.init();
+	vector<bytes> transactionReceipts;
 
 	RLPStream txs;
 	txs.appendList(m_transactions.size());
 
 	for (unsigned i = 0; i < m_transactions.size(); ++i)
 	{
-		RLPStream k;
-		k << i;
 		RLPStream v;
 		m_transactions[i].fillStream(v);
-		transactionReceipts.insert(&k.out(), &v.out());
 		txs.appendRaw(v.out());
+		transactionReceipts.push_back(v.out());
 	}
 
 	txs.swapOut(m_currentTxs);
 	uncles.swapOut(m_currentUncles);
 
-	m_currentBlock.transactionsRoot = transactionReceipts.root();
+	m_currentBlock.transactionsRoot = orderedTrieRoot(transactionReceipts);
 	m_currentBlock.sha3Uncles = sha3(m_currentUncles);
 
 	// Apply rewards last of all.
@@ -748,13 +1028,28 @@ void State::commitToMine(BlockChain const& _bc)
 	m_currentBlock.parentHash = m_previousBlock.hash;
 }
 
-MineInfo State::mine(uint _msTimeout, bool _turbo)
+h256 State::prepareWork()
 {
 	// Update difficulty according to timestamp.
 	m_currentBlock.difficulty = m_currentBlock.calculateDifficulty(m_previousBlock);
+	return m_currentBlock.headerHashWithoutNonce();
+}
+
+bool State::submitWork(h256 const& _nonce)
+{
+	m_currentBlock.nonce = _nonce;
+	if (Dagger::verify(m_currentBlock.headerHashWithoutNonce(), _nonce, m_currentBlock.difficulty))
+		return true;
+	m_currentBytes.clear();
+	return false;
+}
+
+MineInfo State::mine(uint _msTimeout, bool _turbo, unsigned _threads, std::atomic<bool> const* _abort)
+{
+	h256 header = prepareWork();
 
 	// TODO: Miner class that keeps dagger between mine calls (or just non-polling mining).
-	auto ret = m_dagger.mine(/*out*/m_currentBlock.nonce, m_currentBlock.headerHashWithoutNonce(), m_currentBlock.difficulty, _msTimeout, true, _turbo);
+	auto ret = m_dagger.mine(/*out*/m_currentBlock.nonce, header, m_currentBlock.difficulty, _msTimeout, true, _turbo, _threads, _abort);
 
 	if (!ret.completed)
 		m_currentBytes.clear();
@@ -817,6 +1112,8 @@ u256 State::balance(Address _id) const
 void State::noteSending(Address _id)
 {
 	ensureCached(_id, false, false);
+	if (m_access)
+		m_access->writes.insert(_id);
 	auto it = m_cache.find(_id);
 	if (it == m_cache.end())
 		m_cache[_id] = AddressState(1, 0, h256(), EmptySHA3);
@@ -826,7 +1123,10 @@ void State::noteSending(Address _id)
 
 void State::addBalance(Address _id, u256 _amount)
 {
-	ensureCached(_id, false, false);
+	// A blind write: what was there before doesn't matter to us.
+	ensureCached(m_cache, _id, false, false);
+	if (m_access)
+		m_access->writes.insert(_id);
 	auto it = m_cache.find(_id);
 	if (it == m_cache.end())
 		m_cache[_id] = AddressState(0, _amount, h256(), EmptySHA3);
@@ -837,6 +1137,8 @@ void State::addBalance(Address _id, u256 _amount)
 void State::subBalance(Address _id, bigint _amount)
 {
 	ensureCached(_id, false, false);
+	if (m_access)
+		m_access->writes.insert(_id);
 	auto it = m_cache.find(_id);
 	if (it == m_cache.end() || (bigint)it->second.balance() < _amount)
 		throw NotEnoughCash();
@@ -856,7 +1158,10 @@ u256 State::transactionsFrom(Address _id) const
 
 u256 State::storage(Address _id, u256 _memory) const
 {
-	ensureCached(_id, false, false);
+	// Only the slot matters; the account's existence and storage root only change when it's reset.
+	ensureCached(m_cache, _id, false, false);
+	if (m_access)
+		m_access->slotReads.insert(make_pair(_id, _memory));
 	auto it = m_cache.find(_id);
 
 	// Account doesn't exist - exit now.
@@ -880,6 +1185,8 @@ map<u256, u256> State::storage(Address _id) const
 {
 	map<u256, u256> ret;
 
+	if (m_access)
+		m_access->storageReads.insert(_id);
 	ensureCached(_id, false, false);
 	auto it = m_cache.find(_id);
 	if (it != m_cache.end())
@@ -904,6 +1211,8 @@ map<u256, u256> State::storage(Address _id) const
 
 h256 State::storageRoot(Address _id) const
 {
+	if (m_access)
+		m_access->storageReads.insert(_id);
 	string s = m_state.at(_id);
 	if (s.size())
 	{
@@ -959,6 +1268,11 @@ bool State::isTrieGood(bool _enforceRefs, bool _requireNoLeftOvers) const
 // TODO: maintain node overlay revisions for stateroots -> each commit gives a stateroot + OverlayDB; allow overlay copying for rewind operations.
 
 u256 State::execute(bytesConstRef _rlp, bytes* o_output, bool _commit)
+{
+	return execute(Transaction(_rlp), sha3(_rlp), o_output, _commit);
+}
+
+u256 State::execute(Transaction const& _t, h256 const& _hash, bytes* o_output, bool _commit)
 {
 #ifndef ETH_RELEASE
 	commit();	// get an updated hash
@@ -966,15 +1280,15 @@ u256 State::execute(bytesConstRef _rlp, bytes* o_output, bool _commit)
 
 	paranoia("start of execution.", true);
 
-	State old(*this);
 #if ETH_PARANOIA
+	State old(*this);
 	auto h = rootHash();
 #endif
 
 	Manifest ms;
 
 	Executive e(*this, &ms);
-	e.setup(_rlp);
+	e.setup(_t);
 
 	u256 startGasUsed = gasUsed();
 
@@ -994,6 +1308,9 @@ u256 State::execute(bytesConstRef _rlp, bytes* o_output, bool _commit)
 	if (o_output)
 		*o_output = e.out().toBytes();
 
+	if (m_access)
+		noteOutcome(*m_access);
+
 	if (!_commit)
 	{
 		m_cache.clear();
@@ -1023,7 +1340,7 @@ u256 State::execute(bytesConstRef _rlp, bytes* o_output, bool _commit)
 
 	// Add to the user-originated transactions that we've executed.
 	m_transactions.push_back(TransactionReceipt(e.t(), rootHash(), startGasUsed + e.gasUsed(), ms));
-	m_transactionSet.insert(e.t().sha3());
+	m_transactionSet.insert(_hash);
 	return e.gasUsed();
 }
 
@@ -1045,7 +1362,8 @@ bool State::call(Address _receiveAddress, Address _senderAddress, u256 _value, u
 
 	if (addressHasCode(_receiveAddress))
 	{
-		VM vm(*_gas);
+		VMPool::Lease lease(*_gas);
+		VM& vm = *lease;
 		ExtVM evm(*this, _receiveAddress, _senderAddress, _originAddress, _value, _gasPrice, _data, &code(_receiveAddress), o_ms, _level);
 		bool revert = false;
 
@@ -1109,7 +1427,8 @@ h160 State::create(Address _sender, u256 _endowment, u256 _gasPrice, u256* _gas,
 	m_cache[newAddress] = AddressState(0, _endowment, h256(), h256());
 
 	// Execute init code.
-	VM vm(*_gas);
+	VMPool::Lease lease(*_gas);
+	VM& vm = *lease;
 	ExtVM evm(*this, newAddress, _sender, _origin, _endowment, _gasPrice, bytesConstRef(), _code, o_ms, _level);
 	bool revert = false;
 	bytesConstRef out;
@@ -1156,6 +1475,70 @@ h160 State::create(Address _sender, u256 _endowment, u256 _gasPrice, u256* _gas,
 	return newAddress;
 }
 
+StateView::StateView(OverlayDB const& _db, h256 const& _root):
+	m_db(_db),
+	m_state(&m_db, _root)
+{
+}
+
+u256 StateView::balance(Address _a) const
+{
+	string s = m_state.at(_a);
+	return s.empty() ? 0 : RLP(s)[1].toInt<u256>();
+}
+
+u256 StateView::transactionsFrom(Address _a) const
+{
+	string s = m_state.at(_a);
+	return s.empty() ? 0 : RLP(s)[0].toInt<u256>();
+}
+
+h256 StateView::storageRoot(Address _a) const
+{
+	string s = m_state.at(_a);
+	return s.empty() ? h256() : RLP(s)[2].toHash<h256>();
+}
+
+u256 StateView::storage(Address _a, u256 _memory) const
+{
+	h256 root = storageRoot(_a);
+	if (!root)
+		return 0;
+	TrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), root);		// promise we won't alter the overlay! :)
+	string payload = memdb.at(_memory);
+	return payload.size() ? RLP(payload).toInt<u256>() : 0;
+}
+
+map<u256, u256> StateView::storage(Address _a) const
+{
+	map<u256, u256> ret;
+	h256 root = storageRoot(_a);
+	if (root)
+	{
+		TrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), root);		// promise we won't alter the overlay! :)
+		for (auto const& i: memdb)
+			ret[i.first] = RLP(i.second).toInt<u256>();
+	}
+	return ret;
+}
+
+bytes StateView::code(Address _a) const
+{
+	string s = m_state.at(_a);
+	if (s.empty())
+		return bytes();
+	h256 codeHash = RLP(s)[3].toHash<h256>();
+	return codeHash == EmptySHA3 ? bytes() : asBytes(m_db.lookup(codeHash));
+}
+
+map<Address, u256> StateView::addresses() const
+{
+	map<Address, u256> ret;
+	for (auto const& i: m_state)
+		ret[i.first] = RLP(i.second)[1].toInt<u256>();
+	return ret;
+}
+
 State State::fromPending(unsigned _i) const
 {
 	State ret = *this;
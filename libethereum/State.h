@@ -23,6 +23,8 @@
 
 #include <array>
 #include <map>
+#include <memory>
+#include <set>
 #include <unordered_map>
 #include <libethential/Common.h>
 #include <libethential/RLP.h>
@@ -45,6 +47,30 @@ class BlockChain;
 struct StateChat: public LogChannel { static const char* name() { return "=S="; } static const int verbosity = 4; };
 struct StateTrace: public LogChannel { static const char* name() { return "=S="; } static const int verbosity = 7; };
 
+/**
+ * @brief What a transaction's execution touched, as seen through State's accessors.
+ * Headers are an account's existence, nonce, balance and code; slots are single storage locations.
+ * A blind write is one made without first reading, e.g. a balance credited through addBalance().
+ */
+struct StateAccess
+{
+	/// @returns true iff anything we read was written by @a _earlier.
+	bool conflictsWith(StateAccess const& _earlier) const;
+
+	/// Fold @a _later's writes into ours, so we describe both transactions' writes.
+	void absorbWrites(StateAccess const& _later);
+
+	std::set<Address> reads;							///< Accounts whose header was read.
+	std::set<std::pair<Address, u256>> slotReads;		///< Storage slots read.
+	std::set<Address> storageReads;						///< Accounts whose storage was read in its entirety.
+	std::set<Address> writes;							///< Accounts whose header was, or may have been, written.
+	std::set<std::pair<Address, u256>> slotWrites;		///< Storage slots written.
+	std::set<Address> resets;							///< Accounts created or killed outright; these count as writing every slot.
+	std::map<Address, AddressState> loaded;				///< The header of each account as first loaded from the trie; dead if it wasn't there.
+	std::map<Address, AddressState> result;				///< The address cache as it stood when the transaction finished.
+	bool ranCode = false;								///< True if any code ran; it may have read the block's environment.
+};
+
 struct TransactionReceipt
 {
 	TransactionReceipt(Transaction const& _t, h256 _root, u256 _gasUsed, Manifest const& _ms): transaction(_t), stateRoot(_root), gasUsed(_gasUsed), changes(_ms) {}
@@ -62,6 +88,7 @@ struct TransactionReceipt
 	h256 stateRoot;
 	u256 gasUsed;
 	Manifest changes;
+	std::shared_ptr<StateAccess const> access;	///< What executing it touched, if that was recorded.
 };
 
 enum class ExistDiff { Same, New, Dead };
@@ -156,8 +183,19 @@ public:
 	/// Attempt to find valid nonce for block that this state represents.
 	/// This function is thread-safe. You can safely have other interactions with this object while it is happening.
 	/// @param _msTimeout Timeout before return in milliseconds.
+	/// @param _threads Number of threads to mine with.
+	/// @param _abort If given, mining returns early as soon as this becomes true.
 	/// @returns Information on the mining.
-	MineInfo mine(uint _msTimeout = 1000, bool _turbo = false);
+	MineInfo mine(uint _msTimeout = 1000, bool _turbo = false, unsigned _threads = 1, std::atomic<bool> const* _abort = nullptr);
+
+	/// Bring the current block's difficulty up to date for mining elsewhere, e.g. in another process.
+	/// Only valid after commitToMine().
+	/// @returns the hash of the block header without its nonce, i.e. what the miner must find a nonce for.
+	h256 prepareWork();
+
+	/// Set the current block's nonce to one found elsewhere for the header from prepareWork().
+	/// @returns true iff the nonce satisfies the difficulty, in which case completeMine() may follow.
+	bool submitWork(h256 const& _nonce);
 
 	/** Commit to DB and build the final block if the previous call to mine()'s result is completion.
 	 * Typically looks like:
@@ -187,10 +225,19 @@ public:
 	/// Like sync but only operate on _tq, killing the invalid/old ones.
 	bool cull(TransactionQueue& _tq) const;
 
+	/// Carry over the pending transactions of @a _old, a state on an earlier head, onto us, who must have none yet.
+	/// Those that ran no code and read nothing that's since changed are applied as they stand; the rest are executed
+	/// again, and left out if they now fail. Does nothing unless we share a coinbase and every transaction's accesses
+	/// were recorded, as sync() does.
+	/// @returns a list of bloom filters one for each transaction carried over.
+	h256s rebase(State const& _old);
+
 	/// Execute a given transaction.
 	/// This will append @a _t to the transaction list and change the state accordingly.
 	u256 execute(bytes const& _rlp, bytes* o_output = nullptr, bool _commit = true) { return execute(&_rlp, o_output, _commit); }
 	u256 execute(bytesConstRef _rlp, bytes* o_output = nullptr, bool _commit = true);
+	/// Execute a transaction that's already been decoded, e.g. by the transaction queue. @a _hash must be the SHA3 of its RLP.
+	u256 execute(Transaction const& _t, h256 const& _hash, bytes* o_output = nullptr, bool _commit = true);
 
 	/// Get the remaining gas limit in this block.
 	u256 gasLimitRemaining() const { return m_currentBlock.gasLimit - gasUsed(); }
@@ -223,7 +270,7 @@ public:
 	u256 storage(Address _contract, u256 _memory) const;
 
 	/// Set the value of a storage position of an account.
-	void setStorage(Address _contract, u256 _location, u256 _value) { m_cache[_contract].setStorage(_location, _value); }
+	void setStorage(Address _contract, u256 _location, u256 _value) { if (m_access) m_access->slotWrites.insert(std::make_pair(_contract, _location)); m_cache[_contract].setStorage(_location, _value); }
 
 	/// Get the storage of an account.
 	/// @note This is expensive. Don't use it unless you need to.
@@ -275,8 +322,13 @@ public:
 	bool sync(BlockChain const& _bc, h256 _blockHash, BlockInfo const& _bi = BlockInfo());
 
 	/// Execute all transactions within a given block.
+	/// If @a _threads is more than one, the transactions are executed speculatively on that many threads and committed
+	/// in order, re-executing any whose reads an earlier one invalidated. The result is the same either way.
 	/// @returns the additional total difficulty.
-	u256 enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc);
+	u256 enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc, unsigned _threads = 1);
+
+	/// @returns the number of speculatively executed transactions that have had to be executed again, process-wide.
+	static unsigned reexecutions();
 
 	/// Returns back to a pristine state after having done a playback.
 	/// @arg _fullCommit if true flush everything out to disk. If false, this effectively only validates
@@ -301,7 +353,25 @@ private:
 
 	/// Execute the given block, assuming it corresponds to m_currentBlock. If _grandParent is passed, it will be used to check the uncles.
 	/// Throws on failure.
-	u256 enact(bytesConstRef _block, BlockInfo const& _grandParent = BlockInfo(), bool _checkNonce = true);
+	u256 enact(bytesConstRef _block, BlockInfo const& _grandParent = BlockInfo(), bool _checkNonce = true, unsigned _threads = 1);
+
+	/// Execute the given transactions of a block on @a _threads threads against copies of the current state, then
+	/// commit them in order, each exactly as execute() would have. Throws on failure.
+	void enactParallel(RLP const& _transactions, unsigned _threads);
+
+	/// Execute @a _t on an empty cache, recording what it touches in @a o_access, but don't commit it.
+	/// @returns false if it threw, in which case it needs executing again in its proper place.
+	bool speculate(Transaction const& _t, StateAccess& o_access, Manifest& o_ms, u256& o_gasUsed);
+
+	/// Note in @a io_access the headers that the address cache shows were written, along with the cache itself.
+	void noteOutcome(StateAccess& io_access) const;
+
+	/// Apply to the address cache the writes described by @a _access, made against an older state.
+	/// Blindly written balances are applied as deltas; everything else was read and so is known to be current.
+	void applyOutcome(StateAccess const& _access);
+
+	/// Throw if @a _receipt, a transaction's entry in a block, doesn't match what we got executing it.
+	void checkReceipt(RLP const& _receipt) const;
 
 	// Two priviledged entry points for the VM (these don't get added to the Transaction lists):
 	// We assume all instrinsic fees are paid up before this point.
@@ -336,6 +406,7 @@ private:
 	OverlayDB m_lastTx;
 
 	mutable std::map<Address, AddressState> m_cache;	///< Our address cache. This stores the states of each address that has (or at least might have) been changed.
+	StateAccess* m_access = nullptr;			///< If non-null, where our accessors record what they touch. Never copied; see the copy constructor.
 
 	BlockInfo m_previousBlock;					///< The previous block's information.
 	BlockInfo m_currentBlock;					///< The current block's information.
@@ -355,6 +426,50 @@ private:
 	friend std::ostream& operator<<(std::ostream& _out, State const& _s);
 };
 
+/**
+ * @brief Read-only lookups into the state with a given root, made directly on the tries.
+ * For the odd question about a past block, where building (and possibly replaying into) a whole State
+ * would cost far more than the answer.
+ */
+class StateView
+{
+public:
+	/// Open the state with root @a _root in @a _db. Throws RootNotFound if it's not there.
+	StateView(OverlayDB const& _db, h256 const& _root);
+
+	/// Copies query their own copy of the DB, so they needn't outlive the original.
+	StateView(StateView const& _s): m_db(_s.m_db), m_state(&m_db, _s.m_state.root()) {}
+	StateView& operator=(StateView const& _s) { m_db = _s.m_db; m_state.open(&m_db, _s.m_state.root()); return *this; }
+
+	/// Check if the address is in use.
+	bool addressInUse(Address _a) const { return !m_state.at(_a).empty(); }
+
+	/// Get an account's balance. @returns 0 if the address has never been used.
+	u256 balance(Address _a) const;
+
+	/// Get the number of transactions a particular address has sent (used for the transaction nonce).
+	u256 transactionsFrom(Address _a) const;
+
+	/// Get the value of a storage position of an account. @returns 0 if no account exists at that address.
+	u256 storage(Address _a, u256 _memory) const;
+
+	/// Get the storage of an account. @returns an empty map if no account exists at that address.
+	std::map<u256, u256> storage(Address _a) const;
+
+	/// Get the code of an account. @returns an empty byte array if no account exists at that address.
+	bytes code(Address _a) const;
+
+	/// @returns the balance of every address in use.
+	std::map<Address, u256> addresses() const;
+
+private:
+	/// @returns the storage root of the account at @a _a; zero if there's no such account or it has no storage.
+	h256 storageRoot(Address _a) const;
+
+	OverlayDB m_db;
+	TrieDB<Address, OverlayDB> m_state;
+};
+
 std::ostream& operator<<(std::ostream& _out, State const& _s);
 std::ostream& operator<<(std::ostream& _out, StateDiff const& _s);
 std::ostream& operator<<(std::ostream& _out, AccountDiff const& _s);
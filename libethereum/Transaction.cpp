@@ -19,6 +19,7 @@
  * @date 2014
  */
 
+#include <atomic>
 #include <secp256k1/secp256k1.h>
 #include <libethential/vector_ref.h>
 #include <libethential/Log.h>
@@ -29,19 +30,34 @@ using namespace eth;
 
 #define ETH_ADDRESS_DEBUG 0
 
+static std::atomic<unsigned> s_decodes(0);
+static std::atomic<unsigned> s_recoveries(0);
+
+unsigned Transaction::decodes()
+{
+	return s_decodes;
+}
+
+unsigned Transaction::recoveries()
+{
+	return s_recoveries;
+}
+
 Transaction::Transaction(bytesConstRef _rlpData, bool _checkSender)
 {
+	++s_decodes;
 	int field = 0;
 	RLP rlp(_rlpData);
 	try
 	{
-		nonce = rlp[field = 0].toInt<u256>();
-		gasPrice = rlp[field = 1].toInt<u256>();
-		gas = rlp[field = 2].toInt<u256>();
-		receiveAddress = rlp[field = 3].toHash<Address>();
-		value = rlp[field = 4].toInt<u256>();
-		data = rlp[field = 5].toBytes();
-		vrs = Signature{ rlp[field = 6].toInt<byte>(), rlp[field = 7].toInt<u256>(), rlp[field = 8].toInt<u256>() };
+		RLPView fields(rlp);
+		nonce = fields[field = 0].toInt<u256>();
+		gasPrice = fields[field = 1].toInt<u256>();
+		gas = fields[field = 2].toInt<u256>();
+		receiveAddress = fields[field = 3].toHash<Address>();
+		value = fields[field = 4].toInt<u256>();
+		data = fields[field = 5].toBytes();
+		vrs = Signature{ fields[field = 6].toInt<byte>(), fields[field = 7].toInt<u256>(), fields[field = 8].toInt<u256>() };
 		if (_checkSender)
 			m_sender = sender();
 	}
@@ -67,6 +83,7 @@ Address Transaction::sender() const
 {
 	if (!m_sender)
 	{
+		++s_recoveries;
 		secp256k1_start();
 
 		h256 sig[2] = { vrs.r, vrs.s };
@@ -118,7 +135,10 @@ void Transaction::sign(Secret _priv)
 
 void Transaction::fillStream(RLPStream& _s, bool _sig) const
 {
-	_s.appendList((_sig ? 3 : 0) + 6);
+	uint payload = rlpSize(nonce) + rlpSize(gasPrice) + rlpSize(gas) + rlpSize(receiveAddress) + rlpSize(value) + rlpSize(data);
+	if (_sig)
+		payload += rlpSize(vrs.v) + rlpSize(vrs.r) + rlpSize(vrs.s);
+	_s.appendList((_sig ? 3 : 0) + 6, payload);
 	_s << nonce << gasPrice << gas << receiveAddress << value << data;
 	if (_sig)
 		_s << vrs.v << vrs.r << vrs.s;
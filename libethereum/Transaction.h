@@ -68,6 +68,11 @@ struct Transaction
 	h256 sha3(bool _sig = true) const { RLPStream s; fillStream(s, _sig); return eth::sha3(s.out()); }
 	bytes sha3Bytes(bool _sig = true) const { RLPStream s; fillStream(s, _sig); return eth::sha3Bytes(s.out()); }
 
+	/// @returns how many transactions have been decoded from RLP since startup. Thread-safe.
+	static unsigned decodes();
+	/// @returns how many transaction senders have been recovered from signatures since startup. Thread-safe.
+	static unsigned recoveries();
+
 private:
 	mutable Address m_sender;
 };
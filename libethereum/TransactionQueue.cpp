@@ -21,85 +21,237 @@
 
 #include "TransactionQueue.h"
 
+#include <queue>
+
 #include <libethential/Log.h>
 #include <libethcore/Exceptions.h>
-#include "Transaction.h"
 using namespace std;
 using namespace eth;
 
-bool TransactionQueue::import(bytesConstRef _transactionRLP)
+ImportResult TransactionQueue::import(bytesConstRef _transactionRLP)
 {
 	// Check if we already know this transaction.
 	h256 h = sha3(_transactionRLP);
 
 	UpgradableGuard l(m_lock);
-	if (m_known.count(h))
-		return false;
+	if (m_current.count(h) || m_known.count(h) || m_knownOld.count(h))
+		return ImportResult::AlreadyKnown;
 
+	// Check validity of _transactionRLP as a transaction. To do this we just deserialise and attempt to determine the sender.
+	// If it doesn't work, the signature is bad.
+	// The transaction's nonce may yet be invalid (or, it could be "valid" but we may be missing a marginally older transaction).
+	shared_ptr<QueuedTransaction const> q;
 	try
 	{
-		// Check validity of _transactionRLP as a transaction. To do this we just deserialise and attempt to determine the sender.
-		// If it doesn't work, the signature is bad.
-		// The transaction's nonce may yet be invalid (or, it could be "valid" but we may be missing a marginally older transaction).
-		Transaction t(_transactionRLP, true);
-
-		UpgradeGuard ul(l);
-		// If valid, append to blocks.
-		m_current[h] = _transactionRLP.toBytes();
-		m_known.insert(h);
+		q = make_shared<QueuedTransaction const>(_transactionRLP, h);
 	}
 	catch (InvalidTransactionFormat const& _e)
 	{
 		cwarn << "Ignoring invalid transaction: " << _e.description();
-		return false;
 	}
 	catch (std::exception const& _e)
 	{
 		cwarn << "Ignoring invalid transaction: " << _e.what();
-		return false;
 	}
 
-	return true;
+	UpgradeGuard ul(l);
+	if (!q)
+	{
+		++m_status.malformed;
+		return ImportResult::Malformed;
+	}
+
+	auto reject = [&]()
+	{
+		++m_status.rejected;
+		noteKnown(h);
+		return ImportResult::Rejected;
+	};
+
+	// Anything displaced is only dropped for good once the newcomer's sure of its place.
+	shared_ptr<QueuedTransaction const> displaced;
+	auto s = m_senders.find(q->sender);
+	if (s != m_senders.end())
+	{
+		auto same = s->second.find(q->transaction.nonce);
+		if (same != s->second.end())
+		{
+			// Only one transaction per sender and nonce can ever make it into the chain; keep the one paying most.
+			if (m_current.at(same->second)->transaction.gasPrice >= q->transaction.gasPrice)
+				return reject();
+			displaced = m_current.at(same->second);
+		}
+		else if (s->second.size() >= m_limits.perSender)
+		{
+			// The sender has all they're allowed. The later the nonce the less use it is, so only an earlier one gets in.
+			if (s->second.rbegin()->first < q->transaction.nonce)
+				return reject();
+			displaced = m_current.at(s->second.rbegin()->second);
+		}
+		if (displaced)
+			remove(displaced->hash);
+	}
+
+	insert(q);
+	if (!evict(h))
+	{
+		// It was the cheapest; evict() has already noted it as known. What it displaced was queued before, so still fits.
+		if (displaced)
+			insert(displaced);
+		++m_status.rejected;
+		return ImportResult::Rejected;
+	}
+	if (displaced)
+	{
+		noteKnown(displaced->hash);
+		++m_status.evicted;
+	}
+	++m_status.admitted;
+	return ImportResult::Success;
+}
+
+void TransactionQueue::insert(shared_ptr<QueuedTransaction const> const& _t)
+{
+	m_current[_t->hash] = _t;
+	m_bytes += _t->rlp.size();
+	auto& queue = m_senders[_t->sender];
+	if (!queue.empty())
+		m_tails.erase(tail(_t->sender));
+	queue[_t->transaction.nonce] = _t->hash;
+	m_tails.insert(tail(_t->sender));
 }
 
-void TransactionQueue::setFuture(std::pair<h256, bytes> const& _t)
+void TransactionQueue::remove(h256 const& _h)
 {
-	WriteGuard l(m_lock);
-	if (m_current.count(_t.first))
+	auto it = m_current.find(_h);
+	if (it == m_current.end())
+		return;
+	QueuedTransaction const& t = *it->second;
+
+	auto s = m_senders.find(t.sender);
+	m_tails.erase(tail(t.sender));
+	s->second.erase(t.transaction.nonce);
+	if (s->second.empty())
+		m_senders.erase(s);
+	else
+		m_tails.insert(tail(t.sender));
+
+	m_bytes -= t.rlp.size();
+	m_current.erase(it);
+}
+
+bool TransactionQueue::evict(h256 const& _keep)
+{
+	bool ret = true;
+	while (!m_tails.empty() && (m_current.size() > m_limits.count || m_bytes > m_limits.bytes))
+	{
+		h256 h = get<2>(*m_tails.begin());
+		if (h == _keep)
+			ret = false;
+		else
+			++m_status.evicted;
+		remove(h);
+		noteKnown(h);
+	}
+	return ret;
+}
+
+void TransactionQueue::noteKnown(h256 const& _h)
+{
+	if (m_known.size() >= max(1u, m_limits.known / 2))
 	{
-		m_current.erase(_t.first);
-		m_future.insert(make_pair(Transaction(_t.second).sender(), _t));
+		swap(m_known, m_knownOld);
+		m_known.clear();
 	}
+	m_known.insert(_h);
 }
 
-void TransactionQueue::noteGood(std::pair<h256, bytes> const& _t)
+TransactionQueue::Tail TransactionQueue::tail(Address const& _sender) const
+{
+	QueuedTransaction const& t = *m_current.at(m_senders.at(_sender).rbegin()->second);
+	return Tail(t.transaction.gasPrice, t.imported, t.hash);
+}
+
+void TransactionQueue::setLimits(TransactionQueueLimits const& _limits)
 {
 	WriteGuard l(m_lock);
-	auto r = m_future.equal_range(Transaction(_t.second).sender());
-	for (auto it = r.first; it != r.second; ++it)
-		m_current.insert(it->second);
-	m_future.erase(r.first, r.second);
+	m_limits = _limits;
+
+	// Trim any sender over their allowance from the end, then the whole queue as usual.
+	vector<h256> over;
+	for (auto const& s: m_senders)
+	{
+		auto i = s.second.rbegin();
+		for (size_t n = s.second.size(); n > m_limits.perSender; --n, ++i)
+			over.push_back(i->second);
+	}
+	for (auto const& h: over)
+	{
+		remove(h);
+		noteKnown(h);
+		++m_status.evicted;
+	}
+	evict();
+}
+
+TransactionQueueStatus TransactionQueue::status() const
+{
+	ReadGuard l(m_lock);
+	TransactionQueueStatus ret = m_status;
+	ret.current = m_current.size();
+	ret.bytes = m_bytes;
+	ret.senders = m_senders.size();
+	return ret;
+}
+
+std::map<h256, bytes> TransactionQueue::transactions() const
+{
+	ReadGuard l(m_lock);
+	std::map<h256, bytes> ret;
+	for (auto const& i: m_current)
+		ret.insert(ret.end(), make_pair(i.first, i.second->rlp));
+	return ret;
+}
+
+QueuedTransactions TransactionQueue::ordered() const
+{
+	ReadGuard l(m_lock);
+
+	// A heap of each sender's next transaction, highest-priced on top. Ties go to the lower hash, just to be deterministic.
+	typedef std::map<u256, h256>::const_iterator Next;
+	typedef std::pair<Next, Next> Remaining;
+	auto cmp = [&](Remaining const& _a, Remaining const& _b)
+	{
+		auto const& a = *m_current.at(_a.first->second);
+		auto const& b = *m_current.at(_b.first->second);
+		return a.transaction.gasPrice < b.transaction.gasPrice || (a.transaction.gasPrice == b.transaction.gasPrice && b.hash < a.hash);
+	};
+	std::priority_queue<Remaining, std::vector<Remaining>, decltype(cmp)> heads(cmp);
+	for (auto const& i: m_senders)
+		heads.push(make_pair(i.second.begin(), i.second.end()));
+
+	QueuedTransactions ret;
+	ret.reserve(m_current.size());
+	while (!heads.empty())
+	{
+		Remaining r = heads.top();
+		heads.pop();
+		ret.push_back(m_current.at(r.first->second));
+		if (++r.first != r.second)
+			heads.push(r);
+	}
+	return ret;
 }
 
 void TransactionQueue::drop(h256 _txHash)
 {
 	UpgradableGuard l(m_lock);
 
-	if (!m_known.count(_txHash))
+	if (!m_current.count(_txHash) && !m_known.count(_txHash) && !m_knownOld.count(_txHash))
 		return;
 
 	UpgradeGuard ul(l);
 	m_known.erase(_txHash);
-
-	if (m_current.count(_txHash))
-		m_current.erase(_txHash);
-	else
-	{
-		for (auto i = m_future.begin(); i != m_future.end(); ++i)
-			if (i->second.first == _txHash)
-			{
-				m_future.erase(i);
-				break;
-			}
-	}
+	m_knownOld.erase(_txHash);
+	remove(_txHash);
 }
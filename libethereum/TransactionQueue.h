@@ -21,9 +21,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <unordered_set>
 #include <boost/thread.hpp>
 #include <libethential/Common.h>
 #include "libethcore/CommonEth.h"
+#include "Transaction.h"
 #include "Guards.h"
 
 namespace eth
@@ -31,32 +34,118 @@ namespace eth
 
 class BlockChain;
 
+/**
+ * @brief A transaction in the queue: decoded and its sender recovered just the once, on import, then shared
+ * (immutably) with whatever executes or relays it.
+ */
+struct QueuedTransaction
+{
+	QueuedTransaction(bytesConstRef _rlp, h256 const& _hash): hash(_hash), rlp(_rlp.toBytes()), transaction(_rlp, true), sender(transaction.sender()), imported(std::chrono::steady_clock::now()) {}
+
+	h256 hash;
+	bytes rlp;
+	Transaction transaction;
+	Address sender;
+	std::chrono::steady_clock::time_point imported;
+};
+
+typedef std::vector<std::shared_ptr<QueuedTransaction const>> QueuedTransactions;
+
+/// What became of a transaction given to TransactionQueue::import().
+enum class ImportResult
+{
+	Success,		///< It's queued.
+	AlreadyKnown,	///< We've seen it recently.
+	Malformed,		///< It isn't a properly signed transaction.
+	Rejected		///< It's fine, but there's no room for it: it doesn't pay enough to displace anything.
+};
+
+/// How much a TransactionQueue may hold.
+struct TransactionQueueLimits
+{
+	unsigned count = 8192;				///< Most transactions queued at once.
+	size_t bytes = 16 * 1024 * 1024;	///< Most bytes of RLP queued at once.
+	unsigned perSender = 64;			///< Most transactions queued at once from any one sender.
+	unsigned known = 65536;				///< Roughly how many hashes of transactions no longer queued to remember having seen.
+};
+
+/// What's in a TransactionQueue, and what's happened to transactions given to it.
+struct TransactionQueueStatus
+{
+	unsigned current = 0;		///< Transactions queued now.
+	size_t bytes = 0;			///< Bytes of RLP queued now.
+	unsigned senders = 0;		///< Different senders of the transactions queued now.
+	uint64_t admitted = 0;		///< Transactions queued since startup.
+	uint64_t rejected = 0;		///< Valid transactions turned away for want of room.
+	uint64_t evicted = 0;		///< Transactions removed to make room for better-paying ones.
+	uint64_t malformed = 0;		///< Transactions turned away as invalid.
+};
+
 /**
  * @brief A queue of Transactions, each stored as RLP.
+ * Each sender's transactions are kept in nonce order, one per nonce; ordered() interleaves them by gas price.
+ * The queue is bounded: when it's full, the cheapest transaction at the end of some sender's queue (the oldest of
+ * those, should there be several) gives way to one that pays more. Removing only from the end of a sender's queue
+ * means what's left can still all be executed.
  * @threadsafe
  */
 class TransactionQueue
 {
 public:
-	bool attemptImport(bytesConstRef _tx) { try { import(_tx); return true; } catch (...) { return false; } }
+	TransactionQueue(TransactionQueueLimits const& _limits = TransactionQueueLimits()): m_limits(_limits) {}
+
+	bool attemptImport(bytesConstRef _tx) { return import(_tx) == ImportResult::Success; }
 	bool attemptImport(bytes const& _tx) { return attemptImport(&_tx); }
-	bool import(bytesConstRef _tx);
+
+	/// Add a transaction to the queue. If it has the same sender and nonce as one we already have, the higher gas price wins.
+	ImportResult import(bytesConstRef _tx);
 
 	void drop(h256 _txHash);
 
-	std::map<h256, bytes> transactions() const { ReadGuard l(m_lock); return m_current; }
-	std::pair<unsigned, unsigned> items() const { ReadGuard l(m_lock); return std::make_pair(m_current.size(), m_future.size()); }
+	/// @returns true if we've been given the transaction of hash @a _txHash and it's either queued or was recently.
+	bool knows(h256 _txHash) const { ReadGuard l(m_lock); return m_current.count(_txHash) || m_known.count(_txHash) || m_knownOld.count(_txHash); }
+
+	std::map<h256, bytes> transactions() const;
+
+	/// @returns every transaction, each sender's in nonce order, with the senders interleaved so that whichever has the
+	/// highest-priced transaction next in line always goes next. Executing them in this order, a sender whose transaction
+	/// isn't yet valid can be skipped until the next call.
+	QueuedTransactions ordered() const;
+
+	/// @returns the number of transactions and the number of senders they're from.
+	std::pair<unsigned, unsigned> items() const { ReadGuard l(m_lock); return std::make_pair(m_current.size(), m_senders.size()); }
 
-	void setFuture(std::pair<h256, bytes> const& _t);
-	void noteGood(std::pair<h256, bytes> const& _t);
+	/// Change the limits. If they're now lower than what's queued, transactions are evicted until they aren't.
+	void setLimits(TransactionQueueLimits const& _limits);
+	TransactionQueueLimits limits() const { ReadGuard l(m_lock); return m_limits; }
+
+	TransactionQueueStatus status() const;
 
 private:
+	typedef std::tuple<u256, std::chrono::steady_clock::time_point, h256> Tail;
+
+	// All of these must be called with m_lock held for writing.
+
+	/// Put @a _t in the queue and all its indices. Doesn't check limits.
+	void insert(std::shared_ptr<QueuedTransaction const> const& _t);
+	/// Take the transaction of hash @a _h out of the queue and all its indices, if it's there.
+	void remove(h256 const& _h);
+	/// Evict until we're within our limits. @returns false if @a _keep had to go to do it.
+	bool evict(h256 const& _keep = h256());
+	/// Remember having seen @a _h, forgetting the oldest half of what we remember if there's too much.
+	void noteKnown(h256 const& _h);
+	/// @returns the entry in m_tails for the last transaction queued from @a _sender, who must have one.
+	Tail tail(Address const& _sender) const;
+
 	mutable boost::shared_mutex m_lock;							///< General lock.
-	std::set<h256> m_known;										///< Hashes of transactions in both sets.
-	std::map<h256, bytes> m_current;							///< Map of SHA3(tx) to tx.
-	std::multimap<Address, std::pair<h256, bytes>> m_future;	///< For transactions that have a future nonce; we map their sender address to the tx stuff, and insert once the sender has a valid TX.
+	TransactionQueueLimits m_limits;
+	std::unordered_set<h256> m_known;							///< Hashes of transactions we've been given but haven't queued or no longer do...
+	std::unordered_set<h256> m_knownOld;						///< ...and those before. When m_known fills, this is forgotten and m_known becomes it.
+	std::map<h256, std::shared_ptr<QueuedTransaction const>> m_current;	///< Map of SHA3(tx) to tx.
+	std::map<Address, std::map<u256, h256>> m_senders;			///< Each sender's transactions by nonce.
+	std::set<Tail> m_tails;										///< The last transaction of each sender, cheapest then oldest first.
+	size_t m_bytes = 0;											///< Total size of the RLP in m_current.
+	TransactionQueueStatus m_status;							///< Running totals; the first three fields are filled in by status().
 };
 
 }
-
-
@@ -3,3 +3,4 @@
 #include "ExtVMFace.h"
 #include "FeeStructure.h"
 #include "VM.h"
+#include "VMProfiler.h"
@@ -19,13 +19,64 @@
  * @date 2014
  */
 
+#include <boost/thread.hpp>
 #include "VM.h"
 
 using namespace std;
 using namespace eth;
 
+unsigned const eth::c_stackReserve = 1024;
+unsigned const eth::c_memoryPage = 4096;
+unsigned const eth::c_memoryKeep = 1024 * 1024;
+
+static vector<unique_ptr<VM>>& spareVMs()
+{
+#if ALL_COMPILERS_ARE_CPP11_COMPLIANT
+	static thread_local vector<unique_ptr<VM>> s_spare;
+	return s_spare;
+#else
+	static boost::thread_specific_ptr<vector<unique_ptr<VM>>> t_spare;
+	if (!t_spare.get())
+		t_spare.reset(new vector<unique_ptr<VM>>);
+	return *t_spare;
+#endif
+}
+
 void VM::reset(u256 _gas)
 {
 	m_gas = _gas;
 	m_curPC = 0;
+	m_stack.clear();
+	m_temp.clear();
+}
+
+VM* VMPool::take(u256 _gas)
+{
+	auto& pool = spareVMs();
+	if (pool.empty())
+		return new VM(_gas);
+	VM* ret = pool.back().release();
+	pool.pop_back();
+	ret->reset(_gas);
+	return ret;
+}
+
+void VMPool::give(VM* _vm)
+{
+	if (!_vm)
+		return;
+	auto& pool = spareVMs();
+	if (_vm->m_temp.capacity() > c_memoryKeep)
+		bytes().swap(_vm->m_temp);
+	if (_vm->m_stack.capacity() > c_stackReserve)
+	{
+		u256s().swap(_vm->m_stack);
+		_vm->m_stack.reserve(c_stackReserve);
+	}
+	pool.push_back(unique_ptr<VM>(_vm));
+}
+
+size_t VMPool::spare()
+{
+	return spareVMs().size();
 }
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 #include <libethential/Exceptions.h>
 #include <libethcore/CommonEth.h>
@@ -29,6 +30,7 @@
 #include <libethcore/BlockInfo.h>
 #include "FeeStructure.h"
 #include "ExtVMFace.h"
+#include "VMProfiler.h"
 
 namespace eth
 {
@@ -56,21 +58,28 @@ inline u256 fromAddress(Address _a)
 //	return ret;
 }
 
+extern unsigned const c_stackReserve;	///< Stack items reserved by each VM up front, so that ordinary code never grows it.
+extern unsigned const c_memoryPage;		///< Memory is reserved in multiples of this.
+extern unsigned const c_memoryKeep;		///< Memory a pooled VM may hold on to between runs; any more is given back.
+
 /**
  */
 class VM
 {
+	friend class VMPool;
+
 public:
 	/// Construct VM object.
-	explicit VM(u256 _gas = 0) { reset(_gas); }
+	explicit VM(u256 _gas = 0) { m_stack.reserve(c_stackReserve); reset(_gas); }
 
+	/// Start again with @a _gas, an empty stack and no memory. What's been reserved for them is kept.
 	void reset(u256 _gas = 0);
 
 	template <class Ext>
 	bytesConstRef go(Ext& _ext, OnOpFunc const& _onOp = OnOpFunc(), uint64_t _steps = (uint64_t)-1);
 
 	void require(u256 _n) { if (m_stack.size() < _n) throw StackTooSmall(_n, m_stack.size()); }
-	void requireMem(unsigned _n) { if (m_temp.size() < _n) { m_temp.resize(_n); } }
+	void requireMem(unsigned _n) { if (m_temp.size() < _n) growMem(_n); }
 	u256 gas() const { return m_gas; }
 	u256 curPC() const { return m_curPC; }
 
@@ -78,12 +87,56 @@ public:
 	u256s const& stack() const { return m_stack; }
 
 private:
+	/// Expand memory to @a _n bytes, reserving at least twice what we had, in whole pages.
+	void growMem(size_t _n)
+	{
+		if (_n > m_temp.capacity())
+			m_temp.reserve(std::max(m_temp.capacity() * 2, (_n + c_memoryPage - 1) / c_memoryPage * c_memoryPage));
+		m_temp.resize(_n);
+	}
+
 	u256 m_gas = 0;
 	u256 m_curPC = 0;
 	bytes m_temp;
 	u256s m_stack;
 };
 
+/**
+ * @brief VMs kept for reuse, one set per thread, so that a message call needn't allocate a stack and memory afresh.
+ * Calls nest, so VMs are taken and given back last-out-first-in; the pool holds one for each depth that's been reached.
+ */
+class VMPool
+{
+public:
+	/// @returns a VM reset with @a _gas, spare from this thread's pool if there is one.
+	static VM* take(u256 _gas);
+
+	/// Give @a _vm, which came from take(), back to this thread's pool.
+	static void give(VM* _vm);
+
+	/// The number of spare VMs in this thread's pool.
+	static size_t spare();
+
+	/**
+	 * @brief A VM taken from the pool for the lifetime of this object.
+	 */
+	class Lease
+	{
+	public:
+		explicit Lease(u256 _gas): m_vm(take(_gas)) {}
+		~Lease() { give(m_vm); }
+
+		Lease(Lease const&) = delete;
+		Lease& operator=(Lease const&) = delete;
+
+		VM& operator*() const { return *m_vm; }
+		VM* operator->() const { return m_vm; }
+
+	private:
+		VM* m_vm;
+	};
+};
+
 }
 
 // INLINE:
@@ -91,6 +144,7 @@ template <class Ext> eth::bytesConstRef eth::VM::go(Ext& _ext, OnOpFunc const& _
 {
 	u256 nextPC = m_curPC + 1;
 	auto osteps = _steps;
+	VMProfiler::Run profile(_ext.myAddress, _ext.code);
 	for (bool stopped = false; !stopped && _steps--; m_curPC = nextPC, nextPC = m_curPC + 1)
 	{
 		// INSTRUCTION...
@@ -193,9 +247,11 @@ template <class Ext> eth::bytesConstRef eth::VM::go(Ext& _ext, OnOpFunc const& _
 		}
 
 		m_gas = (u256)((bigint)m_gas - runGas);
+		// Gas a CALL hands on is the callee's to account for; whatever it doesn't use comes back.
+		profile.step(inst, inst == Instruction::CALL ? runGas - m_stack.back() : runGas);
 
 		if (newTempSize > m_temp.size())
-			m_temp.resize((size_t)newTempSize);
+			growMem((size_t)newTempSize);
 
 		// EXECUTE...
 		switch (inst)
@@ -0,0 +1,181 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMProfiler.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ */
+
+#include "VMProfiler.h"
+
+#include <mutex>
+#include <iomanip>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <libethcore/SHA3.h>
+using namespace std;
+using namespace eth;
+
+atomic<bool> VMProfiler::s_enabled(false);
+
+static mutex x_profile;
+static VMProfile s_profile;
+#if ALL_COMPILERS_ARE_CPP11_COMPLIANT
+static thread_local VMProfiler::Run* s_current = nullptr;
+static VMProfiler::Run* current() { return s_current; }
+static void setCurrent(VMProfiler::Run* _r) { s_current = _r; }
+#else
+// The thread doesn't own its runs, so there's nothing to clean up on exit.
+static boost::thread_specific_ptr<VMProfiler::Run> t_current([](VMProfiler::Run*){});
+static VMProfiler::Run* current() { return t_current.get(); }
+static void setCurrent(VMProfiler::Run* _r) { t_current.reset(_r); }
+#endif
+
+void VMProfile::merge(VMProfile const& _p)
+{
+	for (unsigned i = 0; i < 256; ++i)
+		opcodes[i].add(_p.opcodes[i]);
+	for (auto const& i: _p.contracts)
+	{
+		ContractProfile& c = contracts[i.first];
+		c.add(i.second);
+		c.runs += i.second.runs;
+		c.codeHash = i.second.codeHash;
+	}
+	if (depths.size() < _p.depths.size())
+		depths.resize(_p.depths.size());
+	for (unsigned i = 0; i < _p.depths.size(); ++i)
+		depths[i].add(_p.depths[i]);
+}
+
+static void streamEntry(std::ostream& _out, ProfileEntry const& _e)
+{
+	_out << setw(12) << _e.steps << setw(16) << _e.gas << setw(12) << fixed << setprecision(3) << _e.ns / 1000000.0 << " ms" << endl;
+}
+
+std::ostream& eth::operator<<(std::ostream& _out, VMProfile const& _p)
+{
+	auto byTime = [](ProfileEntry const* a, ProfileEntry const* b) { return a->ns > b->ns; };
+	ios::fmtflags flags = _out.flags();
+
+	_out << "OPCODES" << setw(24) << "steps" << setw(16) << "gas" << setw(15) << "time" << endl;
+	vector<ProfileEntry const*> ops;
+	for (auto const& i: _p.opcodes)
+		if (i.steps)
+			ops.push_back(&i);
+	sort(ops.begin(), ops.end(), byTime);
+	for (auto i: ops)
+	{
+		Instruction inst = (Instruction)(i - _p.opcodes.data());
+		auto info = c_instructionInfo.find(inst);
+		_out << setw(19) << left << (info == c_instructionInfo.end() ? "0x" + toHex(bytes(1, (byte)inst)) : info->second.name) << right;
+		streamEntry(_out, *i);
+	}
+
+	_out << "CONTRACTS" << endl;
+	vector<pair<Address, ContractProfile const*>> contracts;
+	for (auto const& i: _p.contracts)
+		contracts.push_back(make_pair(i.first, &i.second));
+	sort(contracts.begin(), contracts.end(), [&](pair<Address, ContractProfile const*> const& a, pair<Address, ContractProfile const*> const& b) { return byTime(a.second, b.second); });
+	for (auto const& i: contracts)
+	{
+		_out << i.first << " #" << i.second->codeHash.abridged() << " x" << i.second->runs << endl << setw(19) << "";
+		streamEntry(_out, *i.second);
+	}
+
+	_out << "DEPTHS" << endl;
+	for (unsigned i = 0; i < _p.depths.size(); ++i)
+	{
+		_out << setw(19) << left << i << right;
+		streamEntry(_out, _p.depths[i]);
+	}
+	_out.flags(flags);
+	return _out;
+}
+
+VMProfile VMProfiler::profile()
+{
+	lock_guard<mutex> l(x_profile);
+	return s_profile;
+}
+
+void VMProfiler::reset()
+{
+	lock_guard<mutex> l(x_profile);
+	s_profile = VMProfile();
+}
+
+void VMProfiler::Run::begin(Address const& _address, bytesConstRef _code)
+{
+	m_profile.reset(new VMProfile);
+	m_parent = current();
+	m_depth = m_parent ? m_parent->m_depth + 1 : 0;
+	m_address = _address;
+	m_codeHash = sha3(_code);
+	setCurrent(this);
+	m_start = m_last = Clock::now();
+}
+
+void VMProfiler::Run::closeStep(Clock::time_point _now)
+{
+	if (m_lastInst >= 0)
+	{
+		uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(_now - m_last).count();
+		m_profile->opcodes[m_lastInst].ns += ns > m_calleeNs ? ns - m_calleeNs : 0;
+	}
+	m_calleeNs = 0;
+	m_last = _now;
+}
+
+void VMProfiler::Run::noteStep(Instruction _inst, bigint const& _gas)
+{
+	closeStep(Clock::now());
+	m_lastInst = (int)(byte)_inst;
+	ProfileEntry& e = m_profile->opcodes[m_lastInst];
+	++e.steps;
+	e.gas += _gas;
+	++m_steps;
+	m_gas += _gas;
+}
+
+void VMProfiler::Run::end()
+{
+	auto now = Clock::now();
+	closeStep(now);
+	uint64_t total = chrono::duration_cast<chrono::nanoseconds>(now - m_start).count();
+	uint64_t own = total > m_calleeTotalNs ? total - m_calleeTotalNs : 0;
+
+	ProfileEntry e;
+	e.steps = m_steps;
+	e.gas = m_gas;
+	e.ns = own;
+	ContractProfile& c = m_profile->contracts[m_address];
+	c.add(e);
+	c.codeHash = m_codeHash;
+	c.runs = 1;
+	m_profile->depths.resize(m_depth + 1);
+	m_profile->depths[m_depth] = e;
+
+	if (m_parent)
+	{
+		m_parent->m_calleeNs += total;
+		m_parent->m_calleeTotalNs += total;
+	}
+	setCurrent(m_parent);
+
+	lock_guard<mutex> l(x_profile);
+	s_profile.merge(*m_profile);
+}
@@ -0,0 +1,133 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMProfiler.h
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ */
+
+#pragma once
+
+#include <array>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <libethential/Common.h>
+#include <libethcore/CommonEth.h>
+#include <libevmface/Instruction.h>
+
+namespace eth
+{
+
+/**
+ * @brief The cost of some part of what the VM has executed.
+ */
+struct ProfileEntry
+{
+	void add(ProfileEntry const& _e) { steps += _e.steps; gas += _e.gas; ns += _e.ns; }
+
+	uint64_t steps = 0;		///< Instructions executed.
+	bigint gas = 0;			///< Gas charged for them; this doesn't include any handed on to calls.
+	uint64_t ns = 0;		///< Wall time spent on them, not counting any in code they called.
+};
+
+/**
+ * @brief The cost of the code at one address.
+ */
+struct ContractProfile: public ProfileEntry
+{
+	h256 codeHash;			///< The hash of the code last run there.
+	uint64_t runs = 0;		///< How many times the code was entered.
+};
+
+/**
+ * @brief Where the VM's gas and time went: per opcode, per contract and per call depth.
+ */
+struct VMProfile
+{
+	/// Fold @a _p into this.
+	void merge(VMProfile const& _p);
+
+	std::array<ProfileEntry, 256> opcodes;
+	std::map<Address, ContractProfile> contracts;
+	std::vector<ProfileEntry> depths;
+};
+
+/// Write @a _p as a set of tables, most time-consuming first.
+std::ostream& operator<<(std::ostream& _out, VMProfile const& _p);
+
+/**
+ * @brief Switches VM profiling on and off and keeps the process-wide profile. Thread-safe.
+ * When off, all the VM pays for it is a flag check per instruction.
+ */
+class VMProfiler
+{
+public:
+	static void setEnabled(bool _on) { s_enabled = _on; }
+	static bool enabled() { return s_enabled; }
+
+	/// @returns everything profiled since startup or the last reset().
+	static VMProfile profile();
+
+	/// Forget everything profiled so far.
+	static void reset();
+
+	/**
+	 * @brief One run of the VM over some code, profiled if profiling was on when it began.
+	 * Steps are timed and totalled here and folded into the process-wide profile at the end. Runs on the same thread
+	 * nest, as calls do, so that time spent in callees is counted against them and not their caller.
+	 */
+	class Run
+	{
+	public:
+		Run(Address const& _address, bytesConstRef _code): m_on(s_enabled) { if (m_on) begin(_address, _code); }
+		~Run() { if (m_on) end(); }
+
+		/// Note that @a _inst has been charged @a _gas, less any a CALL hands on, and is about to execute.
+		void step(Instruction _inst, bigint const& _gas) { if (m_on) noteStep(_inst, _gas); }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		void begin(Address const& _address, bytesConstRef _code);
+		void noteStep(Instruction _inst, bigint const& _gas);
+		void end();
+
+		/// Charge the time since the last step, less any spent in callees, to that step's instruction.
+		void closeStep(Clock::time_point _now);
+
+		bool m_on;
+		std::unique_ptr<VMProfile> m_profile;
+		Run* m_parent = nullptr;
+		unsigned m_depth = 0;
+		Address m_address;
+		h256 m_codeHash;
+		Clock::time_point m_start;
+		Clock::time_point m_last;
+		int m_lastInst = -1;
+		uint64_t m_steps = 0;
+		bigint m_gas = 0;
+		uint64_t m_calleeNs = 0;		///< Time spent in callees since the last step.
+		uint64_t m_calleeTotalNs = 0;	///< Time spent in callees altogether.
+	};
+
+private:
+	static std::atomic<bool> s_enabled;
+};
+
+}
@@ -217,7 +217,7 @@ inline bool matches(AssemblyItemsConstRef _a, AssemblyItemsConstRef _b)
 }
 
 struct OptimiserChannel: public LogChannel { static const char* name() { return "OPT"; } static const int verbosity = 12; };
-#define copt eth::LogOutputStream<OptimiserChannel, true>()
+#define copt ETH_LOG_GUARD(OptimiserChannel) eth::LogOutputStream<OptimiserChannel, true>()
 
 Assembly& Assembly::optimise(bool _enable)
 {
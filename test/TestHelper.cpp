@@ -22,6 +22,9 @@
 #include <thread>
 #include <chrono>
 #include <libethereum/Client.h>
+#include <libethereum/State.h>
+#include <libethereum/BlockChain.h>
+#include <libevm/FeeStructure.h>
 #include "TestHelper.h"
 
 namespace eth
@@ -46,4 +49,25 @@ void connectClients(Client& c1, Client& c2)
 	c2.connect("127.0.0.1", c1Port);
 }
 
+void mine(State& _s, BlockChain& _bc, OverlayDB& _stateDB)
+{
+	_s.commitToMine(_bc);
+	while (!_s.mine(100, true).completed) {}
+	_s.completeMine();
+	_bc.attemptImport(_s.blockData(), _stateDB);
+	_s.sync(_bc);
+}
+
+bytes transfer(KeyPair const& _from, u256 _nonce, Address _to, u256 _value, u256 _gasPrice)
+{
+	Transaction t;
+	t.nonce = _nonce;
+	t.value = _value;
+	t.gasPrice = _gasPrice;
+	t.gas = c_txGas;
+	t.receiveAddress = _to;
+	t.sign(_from.secret());
+	return t.rlp();
+}
+
 }
@@ -21,10 +21,23 @@
 
 #pragma once
 
+#include <libethcore/CommonEth.h>
+
 namespace eth
 {
 
+class Client;
+class State;
+class BlockChain;
+class OverlayDB;
+
 void mine(Client& c, int numBlocks);
 void connectClients(Client& c1, Client& c2);
 
+/// Mine a block on @a _s, import it into @a _bc and bring @a _s up to date with it.
+void mine(State& _s, BlockChain& _bc, OverlayDB& _stateDB);
+
+/// @returns a signed transfer of @a _value from @a _from to @a _to, paying @a _gasPrice (by default the minimum) for c_txGas.
+bytes transfer(KeyPair const& _from, u256 _nonce, Address _to, u256 _value, u256 _gasPrice = 10 * szabo);
+
 }
@@ -58,6 +58,42 @@ BOOST_AUTO_TEST_CASE(crypto_tests)
 } 
  
 
+BOOST_AUTO_TEST_CASE(sha3_tests)
+{
+	cnote << "Testing SHA3...";
+	BOOST_REQUIRE_EQUAL(toHex(EmptySHA3.asArray()), "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470");
+	BOOST_REQUIRE_EQUAL(toHex(sha3(string("abc")).asArray()), "4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45");
+
+	// Batches of every size up to a few lanes' worth, with inputs straddling the block boundary.
+	bytes data(1000);
+	for (unsigned i = 0; i < data.size(); ++i)
+		data[i] = (byte)(i * 7 + 3);
+	for (unsigned count = 0; count < 20; ++count)
+	{
+		vector<bytesConstRef> inputs;
+		for (unsigned i = 0; i < count; ++i)
+			inputs.push_back(bytesConstRef(data.data() + i, (count * 67 + i * 131) % 700));
+		auto hashes = sha3(inputs);
+		for (unsigned i = 0; i < count; ++i)
+			BOOST_REQUIRE_EQUAL(hashes[i], sha3(inputs[i]));
+	}
+
+	// A constant prefix absorbed once must hash the same as the whole thing from scratch.
+	h256 prefix = sha3(string("prefix"));
+	SHA3Midstate midstate(prefix);
+	vector<h256> suffixes;
+	for (unsigned i = 0; i < 11; ++i)
+		suffixes.push_back(sha3(toString(i)));
+	vector<h256> midHashes(suffixes.size());
+	midstate(suffixes.data(), suffixes.size(), midHashes.data());
+	for (unsigned i = 0; i < suffixes.size(); ++i)
+	{
+		bytes whole = prefix.asBytes() + suffixes[i].asBytes();
+		BOOST_REQUIRE_EQUAL(midstate(suffixes[i]), sha3(whole));
+		BOOST_REQUIRE_EQUAL(midHashes[i], sha3(whole));
+	}
+}
+
 int cryptoTest()
 {
 	cnote << "Testing Crypto...";
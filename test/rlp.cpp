@@ -191,3 +191,68 @@ BOOST_AUTO_TEST_CASE(rlp_decoding_test)
 }
 
 
+
+BOOST_AUTO_TEST_CASE(rlp_sized_list_test)
+{
+	cnote << "Testing sized RLP lists...";
+	bytes longData(60, 0x42);
+	u256 big = ~u256(0);
+	h256 nonZero = h256(big / 3);
+	for (eth::uint count: { 1, 2, 40 })
+	{
+		eth::uint payload = 0;
+		for (eth::uint i = 0; i < count; ++i)
+			payload += rlpSize(i) + rlpSize(big >> (i * 8 % 256)) + rlpSize(longData) + rlpSize(h256(), false, true) + rlpSize(nonZero) + rlpSize(bytes(1, (byte)i));
+
+		RLPStream unsized(count * 6);
+		RLPStream sized(count * 6, payload);
+		for (eth::uint i = 0; i < count; ++i)
+		{
+			unsized << i << (big >> (i * 8 % 256)) << longData;
+			unsized.append(h256(), false, true) << nonZero << bytes(1, (byte)i);
+			sized << i << (big >> (i * 8 % 256)) << longData;
+			sized.append(h256(), false, true) << nonZero << bytes(1, (byte)i);
+		}
+		BOOST_CHECK(sized.out() == unsized.out());
+		BOOST_CHECK_EQUAL(rlpListSize(payload), sized.out().size());
+
+		bytes buffer;
+		buffer.reserve(1024);
+		auto storage = buffer.data();
+		RLPStream reused(std::move(buffer));
+		reused.appendList(1, rlpSize(longData)) << longData;
+		reused.swapOut(buffer);
+		BOOST_CHECK(buffer == rlpList(longData));
+		BOOST_CHECK(buffer.data() == storage);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(rlp_view_test)
+{
+	cnote << "Testing RLP views...";
+	RLPStream s(20);
+	for (unsigned i = 0; i < 20; ++i)
+		if (i % 3)
+			s << i * 1000;
+		else
+			s.appendList(2) << "cat" << bytes(i * 4, (byte)i);
+	bytes b = s.out();
+	RLP r(b);
+	RLPView v(b);
+	BOOST_CHECK_EQUAL(v.itemCount(), 20);
+	for (unsigned i = 20; i--;)
+		BOOST_CHECK(v[i].data() == r[i].data());
+	BOOST_CHECK(v[20].isNull());
+
+	// Anything after the first item isn't looked at.
+	b.push_back(0xff);
+	BOOST_CHECK(RLPView(b).data().size() == b.size() - 1);
+
+	BOOST_CHECK(RLPView(bytes()).isNull());
+	BOOST_CHECK_THROW(RLPView(fromHex("83646f")), BadRLP);				// runs off the end
+	BOOST_CHECK_THROW(RLPView(fromHex("8105")), BadRLP);				// single byte that should be bare
+	BOOST_CHECK_THROW(RLPView(fromHex("b80100")), BadRLP);				// long form for a short string
+	BOOST_CHECK_THROW(RLPView(fromHex("b90038" + string(112, '0'))), BadRLP);	// length with a leading zero
+	BOOST_CHECK_THROW(RLPView(fromHex("c2820102")), BadRLP);			// item overruns its list
+	BOOST_CHECK_NO_THROW(RLPView(fromHex("c4820102c0")));
+}
@@ -25,9 +25,46 @@
 #include <libethereum/BlockChain.h>
 #include <libethereum/State.h>
 #include <libethereum/Defaults.h>
+#include <libevmface/Instruction.h>
+#include <libevm/FeeStructure.h>
+#include <boost/test/unit_test.hpp>
+#include "TestHelper.h"
 using namespace std;
 using namespace eth;
 
+/// @returns code which, run as a contract's initialiser, makes @a _body (at most 32 bytes) its code.
+static bytes initialiser(bytes const& _body)
+{
+	bytes ret = { (byte)((unsigned)Instruction::PUSH1 + _body.size() - 1) };
+	ret += _body;
+	ret += bytes{ (byte)Instruction::PUSH1, 0, (byte)Instruction::MSTORE, (byte)Instruction::PUSH1, (byte)_body.size(), (byte)Instruction::PUSH1, (byte)(32 - _body.size()), (byte)Instruction::RETURN };
+	return ret;
+}
+
+namespace
+{
+
+/// A block chain and state DB of their own in a fresh directory, removed afterwards, so tests needn't run in any order.
+struct StateFixture
+{
+	struct Directory
+	{
+		Directory(): path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()) {}
+		~Directory() { boost::system::error_code ec; boost::filesystem::remove_all(path, ec); }
+		std::string path;
+	};
+
+	StateFixture(): stateDB(State::openDB(dir.path)), bc(dir.path), s(myMiner.address(), stateDB) {}
+
+	Directory dir;					///< First in, last out: everything using it is closed by the time it goes.
+	KeyPair myMiner = sha3("Gav's Miner");
+	OverlayDB stateDB;
+	BlockChain bc;
+	State s;
+};
+
+}
+
 int stateTest()
 {
 	cnote << "Testing State...";
@@ -91,3 +128,271 @@ int stateTest()
 	return 0;
 }
 
+
+BOOST_FIXTURE_TEST_CASE(state_external_work, StateFixture)
+{
+	cnote << "Testing external mining...";
+
+	s.sync(bc);
+	s.commitToMine(bc);
+
+	// Mine as someone else would: from nothing but the header hash and the difficulty.
+	h256 header = s.prepareWork();
+	u256 difficulty = s.info().difficulty;
+	Dagger miner;
+	h256 nonce;
+	while (!miner.mine(nonce, header, difficulty, 100, true, true).completed) {}
+
+	BOOST_REQUIRE(!s.submitWork(nonce ^ h256(u256(1))));
+	BOOST_REQUIRE(s.submitWork(nonce));
+	s.completeMine();
+	unsigned before = bc.details().number;
+	bc.attemptImport(s.blockData(), stateDB);
+	BOOST_REQUIRE_EQUAL(bc.details().number, before + 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(state_view, StateFixture)
+{
+	cnote << "Testing state views...";
+
+	KeyPair me = sha3("Gav Wood");
+
+	// Two blocks: one to earn some ether, one to give some of it away.
+	s.sync(bc);
+	mine(s, bc, stateDB);
+	u256 meBefore = s.balance(me.address());
+	u256 minerNonceBefore = s.transactionsFrom(myMiner.address());
+	s.execute(transfer(myMiner, minerNonceBefore, me.address(), 1000));
+	mine(s, bc, stateDB);
+
+	StateView v(stateDB, BlockInfo(bc.block()).stateRoot);
+	for (auto a: { me.address(), myMiner.address(), Address() })
+	{
+		BOOST_REQUIRE_EQUAL(v.balance(a), s.balance(a));
+		BOOST_REQUIRE_EQUAL(v.transactionsFrom(a), s.transactionsFrom(a));
+		BOOST_REQUIRE_EQUAL(v.addressInUse(a), s.addressInUse(a));
+	}
+	BOOST_REQUIRE(v.addresses() == s.addresses());
+
+	// And as of the block before, from its header alone.
+	StateView before(stateDB, BlockInfo(bc.block(bc.numberHash(bc.number() - 1))).stateRoot);
+	BOOST_REQUIRE_EQUAL(before.balance(me.address()), meBefore);
+	BOOST_REQUIRE_EQUAL(before.transactionsFrom(myMiner.address()), minerNonceBefore);
+	BOOST_REQUIRE_EQUAL(v.balance(me.address()), meBefore + 1000);
+
+	// Copies stand alone.
+	unique_ptr<StateView> original(new StateView(stateDB, BlockInfo(bc.block()).stateRoot));
+	StateView copy(*original);
+	before = *original;
+	original.reset();
+	BOOST_REQUIRE_EQUAL(copy.balance(me.address()), meBefore + 1000);
+	BOOST_REQUIRE_EQUAL(before.balance(me.address()), meBefore + 1000);
+}
+
+BOOST_FIXTURE_TEST_CASE(blockchain_address_index, StateFixture)
+{
+	cnote << "Testing the address index...";
+
+	KeyPair me = KeyPair::create();
+
+	// Make sure we've something to send, then send it to an address nobody's seen before.
+	s.sync(bc);
+	mine(s, bc, stateDB);
+	s.execute(transfer(myMiner, s.transactionsFrom(myMiner.address()), me.address(), 1000));
+	mine(s, bc, stateDB);
+
+	eth::uint n = bc.number();
+	BOOST_REQUIRE_EQUAL(bc.numberHash(n), bc.currentHash());
+	BOOST_REQUIRE_EQUAL(bc.numberHash(n - 1), bc.details().parent);
+
+	map<eth::uint, set<unsigned>> found;
+	bc.involving(me.address(), 1, n, found);
+	BOOST_REQUIRE_EQUAL(found.size(), 1u);
+	BOOST_REQUIRE_EQUAL(found.begin()->first, n);
+	BOOST_REQUIRE(found.begin()->second == set<unsigned>{0});
+
+	found.clear();
+	bc.involving(me.address(), 1, n - 1, found);
+	BOOST_REQUIRE(found.empty());
+	bc.involving(myMiner.address(), n, n, found);
+	BOOST_REQUIRE_EQUAL(found.size(), 1u);
+}
+
+BOOST_FIXTURE_TEST_CASE(state_parallel_enact, StateFixture)
+{
+	cnote << "Testing parallel block execution...";
+
+	auto message = [&](KeyPair const& _from, Address _to, u256 _value, bytes const& _data, u256 _gas)
+	{
+		Transaction t;
+		t.nonce = s.transactionsFrom(_from.address());
+		t.value = _value;
+		t.gasPrice = 10 * szabo;
+		t.gas = _gas;
+		t.receiveAddress = _to;
+		t.data = _data;
+		t.sign(_from.secret());
+		s.execute(t.rlp());
+		return t.nonce;
+	};
+	auto send = [&](KeyPair const& _from, Address _to, u256 _value)
+	{
+		message(_from, _to, _value, bytes(), c_txGas);
+	};
+	auto call = [&](KeyPair const& _from, Address _to, u256 _value, bytes const& _data)
+	{
+		message(_from, _to, _value, _data, 5000);
+	};
+	auto deploy = [&](KeyPair const& _from, bytes const& _body, u256 _endowment)
+	{
+		return right160(sha3(rlpList(_from.address(), message(_from, Address(), _endowment, initialiser(_body), 5000))));
+	};
+	auto mine = [&]()
+	{
+		s.commitToMine(bc);
+		while (!s.mine(100, true).completed) {}
+		s.completeMine();
+	};
+
+	// Counts its calls in slot 0 and keeps the word it's given under the caller's address.
+	bytes store = { (byte)Instruction::PUSH1, 0, (byte)Instruction::SLOAD, (byte)Instruction::PUSH1, 1, (byte)Instruction::ADD, (byte)Instruction::PUSH1, 0, (byte)Instruction::SSTORE, (byte)Instruction::PUSH1, 0, (byte)Instruction::CALLDATALOAD, (byte)Instruction::CALLER, (byte)Instruction::SSTORE, (byte)Instruction::STOP };
+	// Passes what it's sent on to a new, codeless, contract.
+	bytes factory = { (byte)Instruction::PUSH1, 0, (byte)Instruction::PUSH1, 0, (byte)Instruction::CALLVALUE, (byte)Instruction::CREATE, (byte)Instruction::POP, (byte)Instruction::STOP };
+	// Gives everything it has to whoever calls it.
+	bytes killable = { (byte)Instruction::CALLER, (byte)Instruction::SUICIDE };
+
+	// Earn some ether, spread it around and put up the contracts. The first six keys make transfers; the rest each
+	// make one contract transaction, so that's all they could conflict over.
+	vector<KeyPair> keys;
+	for (unsigned i = 0; i < 13; ++i)
+		keys.push_back(KeyPair::create());
+	s.sync(bc);
+	for (unsigned i = 0; i < 2; ++i)
+	{
+		mine();
+		bc.attemptImport(s.blockData(), stateDB);
+		s.sync(bc);
+	}
+	for (auto const& k: keys)
+		send(myMiner, k.address(), 200 * finney);
+	Address storeAddress = deploy(myMiner, store, 0);
+	Address factoryAddress = deploy(myMiner, factory, 0);
+	Address killableAddress = deploy(myMiner, killable, 1000);
+	mine();
+	bc.attemptImport(s.blockData(), stateDB);
+	s.sync(bc);
+	BOOST_REQUIRE(s.code(storeAddress) == store);
+	BOOST_REQUIRE(s.code(factoryAddress) == factory);
+	BOOST_REQUIRE(s.code(killableAddress) == killable);
+
+	// Mostly disjoint transfers, but one pays someone who then spends it, and the miner (also paid fees by all) sends
+	// twice. Then two calls to the same contract which both write the same slot, a creation, two calls which each
+	// CREATE from the same account, and a suicide followed by a transfer to the account just killed.
+	send(keys[0], KeyPair::create().address(), 1000);
+	send(keys[1], KeyPair::create().address(), 1000);
+	send(keys[2], keys[3].address(), 100 * finney);
+	send(keys[3], keys[4].address(), 250 * finney);
+	send(keys[5], keys[0].address(), 1000);
+	send(myMiner, keys[5].address(), 1000);
+	send(myMiner, keys[1].address(), 1000);
+	call(keys[6], storeAddress, 0, h256(u256(1)).asBytes());
+	call(keys[7], storeAddress, 0, h256(u256(2)).asBytes());
+	Address created = deploy(keys[8], store, 0);
+	call(keys[9], factoryAddress, 1000, bytes());
+	call(keys[10], factoryAddress, 1000, bytes());
+	call(keys[11], killableAddress, 0, bytes());
+	send(keys[12], killableAddress, 1000);
+	mine();
+	bytes block = s.blockData();
+	BlockInfo bi(block);
+
+	State serial(myMiner.address(), stateDB);
+	serial.enactOn(&block, bi, bc, 1);
+	unsigned reexecutionsBefore = State::reexecutions();
+	State parallel(myMiner.address(), stateDB);
+	BOOST_REQUIRE_NO_THROW(parallel.enactOn(&block, bi, bc, 4));
+
+	BOOST_REQUIRE_EQUAL(parallel.rootHash(), serial.rootHash());
+	BOOST_REQUIRE(parallel.pending() == serial.pending());
+	for (unsigned i = 0; i < serial.pending().size(); ++i)
+	{
+		RLPStream ps;
+		RLPStream ss;
+		parallel.changesFromPending(i).streamOut(ps);
+		serial.changesFromPending(i).streamOut(ss);
+		BOOST_REQUIRE(ps.out() == ss.out());
+	}
+	BOOST_REQUIRE(State::reexecutions() > reexecutionsBefore);
+	BOOST_REQUIRE(State::reexecutions() - reexecutionsBefore < serial.pending().size());
+
+	// And they did what they were meant to.
+	BOOST_REQUIRE_EQUAL(serial.pending().size(), 14u);
+	BOOST_REQUIRE_EQUAL(parallel.storage(storeAddress, 0), 2);
+	BOOST_REQUIRE_EQUAL(parallel.storage(storeAddress, (u160)keys[6].address()), 1);
+	BOOST_REQUIRE_EQUAL(parallel.storage(storeAddress, (u160)keys[7].address()), 2);
+	BOOST_REQUIRE(parallel.code(created) == store);
+	BOOST_REQUIRE_EQUAL(parallel.transactionsFrom(factoryAddress), 2);
+	BOOST_REQUIRE_EQUAL(parallel.balance(factoryAddress), 0);
+	BOOST_REQUIRE(!parallel.addressHasCode(killableAddress));
+	BOOST_REQUIRE_EQUAL(parallel.balance(killableAddress), 1000);
+}
+
+BOOST_FIXTURE_TEST_CASE(state_rebase, StateFixture)
+{
+	cnote << "Testing carrying pending transactions over to a new head...";
+
+	auto transfer = [&](KeyPair const& _from, u256 _nonce, Address _to, u256 _value)
+	{
+		Transaction t;
+		t.nonce = _nonce;
+		t.value = _value;
+		t.gasPrice = 10 * szabo;
+		t.gas = c_txGas;
+		t.receiveAddress = _to;
+		t.sign(_from.secret());
+		return t.rlp();
+	};
+	auto mine = [&]()
+	{
+		s.commitToMine(bc);
+		while (!s.mine(100, true).completed) {}
+		s.completeMine();
+		bc.attemptImport(s.blockData(), stateDB);
+		s.sync(bc);
+	};
+
+	// Fund a few senders with enough for one transfer of 1000 and its gas.
+	u256 funding = c_txGas * 10 * szabo + 1000;
+	vector<KeyPair> keys;
+	for (unsigned i = 0; i < 3; ++i)
+		keys.push_back(KeyPair::create());
+	s.sync(bc);
+	mine();
+	for (auto const& k: keys)
+		s.execute(transfer(myMiner, s.transactionsFrom(myMiner.address()), k.address(), funding));
+	mine();
+
+	// Three pending transfers; the next block spends the first's nonce and pays the second's recipient.
+	Address paid = KeyPair::create().address();
+	TransactionQueue tq;
+	for (auto const& t: { transfer(keys[0], 0, KeyPair::create().address(), 1000), transfer(keys[1], 0, paid, 1000), transfer(keys[2], 0, KeyPair::create().address(), 1000) })
+		tq.import(&t);
+	State pending(myMiner.address(), stateDB);
+	pending.sync(bc);
+	BOOST_REQUIRE_EQUAL(pending.sync(tq).size(), 3u);
+
+	s.execute(transfer(keys[0], 0, KeyPair::create().address(), 1000));
+	s.execute(transfer(myMiner, s.transactionsFrom(myMiner.address()), paid, 1000));
+	mine();
+
+	State rebased(myMiner.address(), stateDB);
+	rebased.sync(bc);
+	BOOST_REQUIRE_EQUAL(rebased.rebase(pending).size(), 2u);
+
+	State scratch(myMiner.address(), stateDB);
+	scratch.sync(bc);
+	scratch.sync(tq);
+	BOOST_REQUIRE_EQUAL(scratch.pending().size(), 2u);
+	BOOST_REQUIRE_EQUAL(rebased.rootHash(), scratch.rootHash());
+	BOOST_REQUIRE_EQUAL(rebased.gasLimitRemaining(), scratch.gasLimitRemaining());
+}
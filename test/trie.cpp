@@ -234,6 +234,30 @@ BOOST_AUTO_TEST_CASE(moreTrieTests)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(trieRootTests)
+{
+	cnote << "Testing direct trie roots...";
+	mt19937 gen(42);
+	vector<bytes> manifest;
+	for (unsigned n = 0; n < 300; n += 1 + n / 8)
+	{
+		MemoryDB m;
+		GenericTrieDB<MemoryDB> d(&m);
+		d.init();
+		StringMap s;
+		manifest.clear();
+		for (unsigned i = 0; i < n; ++i)
+		{
+			bytes k = rlp(i);
+			manifest.push_back(bytes(1 + gen() % 200, (byte)i));
+			d.insert(&k, &manifest.back());
+			s[asString(k)] = asString(manifest.back());
+		}
+		BOOST_REQUIRE_EQUAL(orderedTrieRoot(manifest), d.root());
+		BOOST_REQUIRE_EQUAL(trieRoot(s), d.root());
+	}
+}
+
 BOOST_AUTO_TEST_CASE(trieStess)
 {
 	cnote << "Stress-testing Trie...";
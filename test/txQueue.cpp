@@ -0,0 +1,266 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file txQueue.cpp
+ * @author Gav Wood <i@gavwood.com>
+ * @date 2014
+ * Transaction queue tests.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethential/Log.h>
+#include <libevm/FeeStructure.h>
+#include <libethereum/TransactionQueue.h>
+#include "TestHelper.h"
+using namespace std;
+using namespace eth;
+
+namespace
+{
+
+/// A transfer from @a _from with nonce @a _nonce at @a _gasPrice wei.
+bytes tx(KeyPair const& _from, u256 _nonce, u256 _gasPrice)
+{
+	return transfer(_from, _nonce, Address(), 1, _gasPrice);
+}
+
+bool queued(TransactionQueue const& _tq, bytes const& _t)
+{
+	return _tq.transactions().count(sha3(_t));
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(txqueue_import_results)
+{
+	cnote << "Testing transaction queue import results...";
+
+	KeyPair k = KeyPair::create();
+	TransactionQueue tq;
+	bytes t = tx(k, 0, 10);
+	BOOST_REQUIRE(tq.import(&t) == ImportResult::Success);
+	BOOST_REQUIRE(tq.import(&t) == ImportResult::AlreadyKnown);
+	BOOST_REQUIRE(tq.knows(sha3(t)));
+
+	// Well-formed RLP, but no sender can be recovered from it.
+	Transaction bad(&t, false);
+	bad.vrs.r = 0;
+	bad.vrs.s = 0;
+	bytes b = bad.rlp();
+	BOOST_REQUIRE(tq.import(&b) == ImportResult::Malformed);
+	BOOST_REQUIRE(!tq.knows(sha3(b)));
+
+	TransactionQueueStatus s = tq.status();
+	BOOST_REQUIRE_EQUAL(s.current, 1u);
+	BOOST_REQUIRE_EQUAL(s.senders, 1u);
+	BOOST_REQUIRE_EQUAL(s.bytes, t.size());
+	BOOST_REQUIRE_EQUAL(s.admitted, 1u);
+	BOOST_REQUIRE_EQUAL(s.malformed, 1u);
+	BOOST_REQUIRE_EQUAL(s.rejected, 0u);
+
+	// Dropped transactions are forgotten altogether.
+	tq.drop(sha3(t));
+	BOOST_REQUIRE(!tq.knows(sha3(t)));
+	BOOST_REQUIRE_EQUAL(tq.items().first, 0u);
+	BOOST_REQUIRE(tq.import(&t) == ImportResult::Success);
+}
+
+BOOST_AUTO_TEST_CASE(txqueue_replacement)
+{
+	cnote << "Testing same-nonce replacement...";
+
+	KeyPair k = KeyPair::create();
+	TransactionQueue tq;
+	bytes first = tx(k, 0, 10);
+	bytes same = tx(k, 0, 10);
+	bytes cheaper = tx(k, 0, 9);
+	bytes dearer = tx(k, 0, 11);
+	BOOST_REQUIRE(tq.import(&first) == ImportResult::Success);
+
+	// Paying no more isn't enough.
+	BOOST_REQUIRE(tq.import(&cheaper) == ImportResult::Rejected);
+	BOOST_REQUIRE(sha3(same) == sha3(first) || tq.import(&same) == ImportResult::Rejected);
+	BOOST_REQUIRE(queued(tq, first));
+	BOOST_REQUIRE(tq.knows(sha3(cheaper)));
+
+	// Paying more is.
+	BOOST_REQUIRE(tq.import(&dearer) == ImportResult::Success);
+	BOOST_REQUIRE(!queued(tq, first));
+	BOOST_REQUIRE(queued(tq, dearer));
+	BOOST_REQUIRE(tq.knows(sha3(first)));
+	BOOST_REQUIRE(tq.import(&first) == ImportResult::AlreadyKnown);
+	BOOST_REQUIRE_EQUAL(tq.items().first, 1u);
+	BOOST_REQUIRE_EQUAL(tq.status().evicted, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(txqueue_per_sender)
+{
+	cnote << "Testing the per-sender limit...";
+
+	TransactionQueueLimits limits;
+	limits.perSender = 2;
+	KeyPair k = KeyPair::create();
+	TransactionQueue tq(limits);
+	bytes t1 = tx(k, 1, 10);
+	bytes t2 = tx(k, 2, 10);
+	bytes t3 = tx(k, 3, 100);
+	bytes t0 = tx(k, 0, 1);
+	BOOST_REQUIRE(tq.import(&t1) == ImportResult::Success);
+	BOOST_REQUIRE(tq.import(&t2) == ImportResult::Success);
+
+	// A later nonce is no use while the earlier ones are queued, whatever it pays...
+	BOOST_REQUIRE(tq.import(&t3) == ImportResult::Rejected);
+	BOOST_REQUIRE(!queued(tq, t3));
+
+	// ...but an earlier one displaces the last.
+	BOOST_REQUIRE(tq.import(&t0) == ImportResult::Success);
+	BOOST_REQUIRE(queued(tq, t0));
+	BOOST_REQUIRE(queued(tq, t1));
+	BOOST_REQUIRE(!queued(tq, t2));
+	BOOST_REQUIRE_EQUAL(tq.items().first, 2u);
+
+	// Others are unaffected.
+	KeyPair other = KeyPair::create();
+	bytes o = tx(other, 0, 1);
+	BOOST_REQUIRE(tq.import(&o) == ImportResult::Success);
+	BOOST_REQUIRE_EQUAL(tq.items().second, 2u);
+
+	// Lowering the limit trims each sender from the end.
+	limits.perSender = 1;
+	tq.setLimits(limits);
+	BOOST_REQUIRE(queued(tq, t0));
+	BOOST_REQUIRE(!queued(tq, t1));
+	BOOST_REQUIRE(queued(tq, o));
+}
+
+BOOST_AUTO_TEST_CASE(txqueue_eviction)
+{
+	cnote << "Testing eviction from a full queue...";
+
+	TransactionQueueLimits limits;
+	limits.count = 2;
+	TransactionQueue tq(limits);
+	KeyPair a = KeyPair::create();
+	KeyPair b = KeyPair::create();
+	KeyPair c = KeyPair::create();
+	KeyPair d = KeyPair::create();
+	bytes ta = tx(a, 0, 20);
+	bytes tb = tx(b, 0, 10);
+	bytes tc = tx(c, 0, 30);
+	bytes td = tx(d, 0, 5);
+	BOOST_REQUIRE(tq.import(&ta) == ImportResult::Success);
+	BOOST_REQUIRE(tq.import(&tb) == ImportResult::Success);
+
+	// Full: the cheapest tail goes to make way for one that pays more...
+	BOOST_REQUIRE(tq.import(&tc) == ImportResult::Success);
+	BOOST_REQUIRE(!queued(tq, tb));
+	BOOST_REQUIRE(queued(tq, ta));
+	BOOST_REQUIRE(queued(tq, tc));
+	BOOST_REQUIRE(tq.knows(sha3(tb)));
+
+	// ...but one that pays less than everything's turned away.
+	BOOST_REQUIRE(tq.import(&td) == ImportResult::Rejected);
+	BOOST_REQUIRE(!queued(tq, td));
+	BOOST_REQUIRE(tq.import(&td) == ImportResult::AlreadyKnown);
+
+	// Only a sender's last transaction may go, so their earlier ones stay executable.
+	bytes ta1 = tx(a, 1, 1);
+	BOOST_REQUIRE(tq.import(&ta1) == ImportResult::Rejected);
+	BOOST_REQUIRE(queued(tq, ta));
+
+	TransactionQueueStatus s = tq.status();
+	BOOST_REQUIRE_EQUAL(s.current, 2u);
+	BOOST_REQUIRE_EQUAL(s.admitted, 3u);
+	BOOST_REQUIRE_EQUAL(s.evicted, 1u);
+	BOOST_REQUIRE_EQUAL(s.rejected, 2u);
+
+	// The byte limit works the same way.
+	limits.bytes = tc.size();
+	tq.setLimits(limits);
+	BOOST_REQUIRE_EQUAL(tq.items().first, 1u);
+	BOOST_REQUIRE(queued(tq, tc));
+	BOOST_REQUIRE_EQUAL(tq.status().bytes, tc.size());
+}
+
+BOOST_AUTO_TEST_CASE(txqueue_replacement_evicted)
+{
+	cnote << "Testing a replacement that doesn't fit...";
+
+	KeyPair a = KeyPair::create();
+	KeyPair b = KeyPair::create();
+	bytes ta = tx(a, 0, 20);
+	bytes tb = tx(b, 0, 5);
+
+	// Pays more than tb, but is bigger and still the cheapest in the queue.
+	Transaction t;
+	t.nonce = 0;
+	t.gasPrice = 6;
+	t.gas = c_txGas;
+	t.data = bytes(100, 0);
+	t.sign(b.secret());
+	bytes tb1 = t.rlp();
+
+	TransactionQueueLimits limits;
+	limits.bytes = ta.size() + tb.size();
+	TransactionQueue tq(limits);
+	BOOST_REQUIRE(tq.import(&ta) == ImportResult::Success);
+	BOOST_REQUIRE(tq.import(&tb) == ImportResult::Success);
+
+	// Turned away, leaving what it would have replaced where it was.
+	BOOST_REQUIRE(tq.import(&tb1) == ImportResult::Rejected);
+	BOOST_REQUIRE(!queued(tq, tb1));
+	BOOST_REQUIRE(queued(tq, ta));
+	BOOST_REQUIRE(queued(tq, tb));
+	BOOST_REQUIRE(tq.import(&tb1) == ImportResult::AlreadyKnown);
+
+	TransactionQueueStatus s = tq.status();
+	BOOST_REQUIRE_EQUAL(s.current, 2u);
+	BOOST_REQUIRE_EQUAL(s.senders, 2u);
+	BOOST_REQUIRE_EQUAL(s.bytes, ta.size() + tb.size());
+	BOOST_REQUIRE_EQUAL(s.evicted, 0u);
+	BOOST_REQUIRE_EQUAL(s.rejected, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(txqueue_known_rollover)
+{
+	cnote << "Testing forgetting old transaction hashes...";
+
+	// Room for one transaction, and memory of two to four more.
+	TransactionQueueLimits limits;
+	limits.count = 1;
+	limits.known = 4;
+	TransactionQueue tq(limits);
+	bytes top = tx(KeyPair::create(), 0, 100);
+	BOOST_REQUIRE(tq.import(&top) == ImportResult::Success);
+
+	vector<bytes> turnedAway;
+	for (unsigned i = 0; i < 5; ++i)
+	{
+		turnedAway.push_back(tx(KeyPair::create(), 0, 1));
+		BOOST_REQUIRE(tq.import(&turnedAway.back()) == ImportResult::Rejected);
+	}
+
+	// Each time two are remembered the older two are forgotten.
+	BOOST_REQUIRE(!tq.knows(sha3(turnedAway[0])));
+	BOOST_REQUIRE(!tq.knows(sha3(turnedAway[1])));
+	for (unsigned i = 2; i < 5; ++i)
+		BOOST_REQUIRE(tq.knows(sha3(turnedAway[i])));
+	BOOST_REQUIRE(tq.knows(sha3(top)));
+
+	// Forgotten, so it's considered afresh.
+	BOOST_REQUIRE(tq.import(&turnedAway[0]) == ImportResult::Rejected);
+	BOOST_REQUIRE(tq.import(&turnedAway[4]) == ImportResult::AlreadyKnown);
+}
@@ -503,3 +503,85 @@ BOOST_AUTO_TEST_CASE(vm_tests)
 		BOOST_ERROR("Failed VM Test with Exception: " << e.what()); 
 	}
 }
+
+BOOST_AUTO_TEST_CASE(vm_profile)
+{
+	cnote << "Testing VM profiling...";
+
+	bytes code = { (byte)Instruction::PUSH1, 2, (byte)Instruction::PUSH1, 3, (byte)Instruction::ADD, (byte)Instruction::STOP };
+	eth::test::FakeExtVM fev;
+	fev.myAddress = right160(sha3("contract"));
+	fev.code = &code;
+
+	// Nothing's recorded while it's off.
+	VMProfiler::reset();
+	VM(1000).go(fev);
+	BOOST_REQUIRE(VMProfiler::profile().contracts.empty());
+
+	VMProfiler::setEnabled(true);
+	VM vm(1000);
+	vm.go(fev);
+	VMProfiler::setEnabled(false);
+
+	VMProfile p = VMProfiler::profile();
+	BOOST_REQUIRE_EQUAL(p.opcodes[(byte)Instruction::PUSH1].steps, 2u);
+	BOOST_REQUIRE_EQUAL(p.opcodes[(byte)Instruction::ADD].steps, 1u);
+	BOOST_REQUIRE_EQUAL(p.opcodes[(byte)Instruction::STOP].steps, 1u);
+	BOOST_REQUIRE_EQUAL(p.contracts.size(), 1u);
+	ContractProfile const& c = p.contracts.at(fev.myAddress);
+	BOOST_REQUIRE_EQUAL(c.runs, 1u);
+	BOOST_REQUIRE_EQUAL(c.steps, 4u);
+	BOOST_REQUIRE(c.gas == 1000 - vm.gas());
+	BOOST_REQUIRE_EQUAL(c.codeHash, sha3(code));
+	BOOST_REQUIRE_EQUAL(p.depths.size(), 1u);
+	BOOST_REQUIRE_EQUAL(p.depths[0].steps, 4u);
+
+	// A CALL is charged only its own cost, not the gas it hands on.
+	bytes call = { (byte)Instruction::PUSH1, 0, (byte)Instruction::PUSH1, 0, (byte)Instruction::PUSH1, 0, (byte)Instruction::PUSH1, 0, (byte)Instruction::PUSH1, 0, (byte)Instruction::PUSH1, 1, (byte)Instruction::PUSH2, 0x01, 0xf4, (byte)Instruction::CALL, (byte)Instruction::STOP };
+	fev.code = &call;
+	VMProfiler::reset();
+	VMProfiler::setEnabled(true);
+	VM callVM(1000);
+	callVM.go(fev);
+	VMProfiler::setEnabled(false);
+
+	p = VMProfiler::profile();
+	BOOST_REQUIRE(p.opcodes[(byte)Instruction::CALL].gas == c_callGas);
+	BOOST_REQUIRE(p.contracts.at(fev.myAddress).gas == 1000 - callVM.gas());
+}
+
+BOOST_AUTO_TEST_CASE(vm_pool)
+{
+	cnote << "Testing VM reuse...";
+
+	// Leaves 3 on the stack and a word in memory at 5000, so memory expands to 5056 bytes.
+	bytes code = { (byte)Instruction::PUSH1, 3, (byte)Instruction::DUP1, (byte)Instruction::PUSH2, 0x13, 0x88, (byte)Instruction::MSTORE, (byte)Instruction::STOP };
+	eth::test::FakeExtVM fev;
+	fev.code = &code;
+
+	VM* first;
+	{
+		VMPool::Lease vm(1000);
+		first = &*vm;
+		BOOST_REQUIRE(vm->stack().capacity() >= c_stackReserve);
+		vm->go(fev);
+		BOOST_REQUIRE_EQUAL(vm->stack().size(), 1u);
+		BOOST_REQUIRE_EQUAL(vm->memory().size(), 5056u);
+		BOOST_REQUIRE_EQUAL(vm->memory().capacity() % c_memoryPage, 0u);
+	}
+	size_t spare = VMPool::spare();
+	BOOST_REQUIRE(spare >= 1);
+
+	// The same VM comes back, clean but with its memory still reserved.
+	VMPool::Lease vm(1000);
+	BOOST_REQUIRE_EQUAL(&*vm, first);
+	BOOST_REQUIRE_EQUAL(VMPool::spare(), spare - 1);
+	BOOST_REQUIRE(vm->stack().empty());
+	BOOST_REQUIRE(vm->memory().empty());
+	BOOST_REQUIRE(vm->memory().capacity() >= 5056u);
+	BOOST_REQUIRE(vm->gas() == 1000);
+
+	// Nested leases get different VMs.
+	VMPool::Lease inner(1000);
+	BOOST_REQUIRE(&*inner != first);
+}